@@ -21,13 +21,25 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
 namespace rpcmple
 {
 	namespace connectionManager
 	{
+		// bytes written by base::writeSegments, which must stay valid until it returns
+		struct segment
+		{
+			const uint8_t* data;
+			size_t size;
+		};
+
 		/* base is pure virtual class defining operation for stream opening, closing, reading and writing */
 		class base {
+		private:
+			std::vector<uint8_t> readScratch;
+			std::vector<uint8_t> writeScratch;
+
 		public:
 			base()= default;
 			virtual ~base()=default;
@@ -36,6 +48,30 @@ namespace rpcmple
 			virtual bool write(std::vector<uint8_t>&)=0;
 			virtual bool read(std::vector<uint8_t>&, uint32_t*)=0;
 			virtual bool close()=0;
+
+			/* reads up to size bytes to bytes, which is how messageManager reads into its buffer. Connections should
+			 * override it to read in place, the default implementation reads through read and copies
+			 */
+			virtual bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead)
+			{
+				readScratch.resize(size);
+				if (!read(readScratch, pBytesRead)) return false;
+				std::memcpy(bytes, readScratch.data(), *pBytesRead);
+				return true;
+			}
+
+			/* writes the segments one after the other, as a single write. Connections should override it to gather
+			 * them in one system call, the default implementation copies them to a buffer and writes it
+			 */
+			virtual bool writeSegments(const segment* segments, size_t count)
+			{
+				writeScratch.clear();
+				for (size_t i = 0; i < count; i++)
+				{
+					writeScratch.insert(writeScratch.end(), segments[i].data, segments[i].data + segments[i].size);
+				}
+				return write(writeScratch);
+			}
 		};
 	}
 }
@@ -76,10 +76,14 @@ namespace rpcmple
 			}
 
 			bool read(std::vector<uint8_t>& bytes, uint32_t* pBytesRead) override {
+				return readInto(bytes.data(), bytes.size(), pBytesRead);
+			}
+
+			bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead) override {
 				BOOL success = ReadFile(
 						   hPipe,
-						   bytes.data(),
-						   bytes.size(),
+						   bytes,
+						   size,
 						   (DWORD*)pBytesRead,
 						   nullptr);
 				if (!success) {
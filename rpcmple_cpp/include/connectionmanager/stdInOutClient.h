@@ -53,9 +53,24 @@ namespace rpcmple
 				return true;
 			}
 
+			bool writeSegments(const segment* segments, size_t count) override {
+				for (size_t i = 0; i < count; i++) {
+					std::cout.write(reinterpret_cast<const char*>(segments[i].data), segments[i].size);
+				}
+				if (!std::cout) {
+					spdlog::error("connectionManagerStdInOut: stream error occurred during write");
+					return false;
+				}
+				return true;
+			}
+
 			bool read(std::vector<uint8_t>& bytes, uint32_t* pBytesRead) override {
-				spdlog::debug("connectionManagerStdInOut: reading data from stdin expecting {} bytes", bytes.size());
-				std::cin.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+				return readInto(bytes.data(), bytes.size(), pBytesRead);
+			}
+
+			bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead) override {
+				spdlog::debug("connectionManagerStdInOut: reading data from stdin expecting {} bytes", size);
+				std::cin.read(reinterpret_cast<char*>(bytes), size);
 				*pBytesRead = std::cin.gcount();
 				if (std::cin.eof()) {
 					spdlog::debug("connectionManagerStdInOut: EOF reached");
@@ -37,6 +37,7 @@ namespace rpcmple
 		{
 		private:
 			SOCKET connectSocket;
+			std::vector<WSABUF> wsaBuffers;
 			std::string serverAddress;
 			int serverPort;
 
@@ -114,9 +115,48 @@ namespace rpcmple
 				return true;
 			}
 
+			// Writes the segments with a single WSASend, resuming after a partial send
+			bool writeSegments(const segment* segments, size_t count) override
+			{
+				wsaBuffers.resize(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					wsaBuffers[i].buf = (CHAR*)segments[i].data;
+					wsaBuffers[i].len = (ULONG)segments[i].size;
+				}
+
+				size_t first = 0;
+				while (first < count)
+				{
+					DWORD bytesSent = 0;
+					if (WSASend(connectSocket, wsaBuffers.data() + first, (DWORD)(count - first), &bytesSent, 0,
+					            nullptr, nullptr) == SOCKET_ERROR)
+					{
+						spdlog::error("SocketClient: send failed with error: {}", WSAGetLastError());
+						return false;
+					}
+					while (first < count && bytesSent >= wsaBuffers[first].len)
+					{
+						bytesSent -= wsaBuffers[first].len;
+						first++;
+					}
+					if (first < count)
+					{
+						wsaBuffers[first].buf += bytesSent;
+						wsaBuffers[first].len -= bytesSent;
+					}
+				}
+				return true;
+			}
+
 			bool read(std::vector<uint8_t>& bytes, uint32_t* pBytesRead) override
 			{
-				int bytesReceived = recv(connectSocket, (char*)bytes.data(), bytes.size(), 0);
+				return readInto(bytes.data(), bytes.size(), pBytesRead);
+			}
+
+			bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead) override
+			{
+				int bytesReceived = recv(connectSocket, (char*)bytes, size, 0);
 				if (bytesReceived == SOCKET_ERROR)
 				{
 					spdlog::error("SocketClient: recv failed with error: {}", WSAGetLastError());
@@ -95,6 +95,7 @@ namespace rpcmple
 			SOCKET listenSocket;
 			SOCKET clientSocket;
 			bool readyToAccept;
+			std::vector<WSABUF> wsaBuffers;
 
 		public:
 			explicit tcpSocketServer(SOCKET socket)
@@ -148,8 +149,53 @@ namespace rpcmple
 				return true;
 			}
 
+			// Writes the segments with a single WSASend, resuming after a partial send
+			bool writeSegments(const segment* segments, size_t count) override
+			{
+				if (clientSocket == INVALID_SOCKET)
+				{
+					spdlog::error("SocketServer: no client is connected");
+					return false;
+				}
+
+				wsaBuffers.resize(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					wsaBuffers[i].buf = (CHAR*)segments[i].data;
+					wsaBuffers[i].len = (ULONG)segments[i].size;
+				}
+
+				size_t first = 0;
+				while (first < count)
+				{
+					DWORD bytesSent = 0;
+					if (WSASend(clientSocket, wsaBuffers.data() + first, (DWORD)(count - first), &bytesSent, 0,
+					            nullptr, nullptr) == SOCKET_ERROR)
+					{
+						spdlog::error("SocketServer: send failed with error: {}", WSAGetLastError());
+						return false;
+					}
+					while (first < count && bytesSent >= wsaBuffers[first].len)
+					{
+						bytesSent -= wsaBuffers[first].len;
+						first++;
+					}
+					if (first < count)
+					{
+						wsaBuffers[first].buf += bytesSent;
+						wsaBuffers[first].len -= bytesSent;
+					}
+				}
+				return true;
+			}
+
 			// Reads data from the connected client
 			bool read(std::vector<uint8_t>& bytes, uint32_t* pBytesRead) override
+			{
+				return readInto(bytes.data(), bytes.size(), pBytesRead);
+			}
+
+			bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead) override
 			{
 				if (clientSocket == INVALID_SOCKET)
 				{
@@ -157,7 +203,7 @@ namespace rpcmple
 					return false;
 				}
 
-				int bytesReceived = recv(clientSocket, (char*)bytes.data(), bytes.size(), 0);
+				int bytesReceived = recv(clientSocket, (char*)bytes, size, 0);
 				if (bytesReceived == SOCKET_ERROR)
 				{
 					spdlog::error("SocketServer: receive failed with error: {}", WSAGetLastError());
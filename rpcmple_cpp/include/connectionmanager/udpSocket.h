@@ -42,6 +42,7 @@ namespace rpcmple
 			std::vector<uint8_t> internalBuffer;
 			int internalBufferStartPos;
 			int internalBufferEndPos;
+			std::vector<WSABUF> wsaBuffers;
 
 		public:
 			explicit udpSocket(int listenPort = -1, int clientPort = -1, std::string clientAddress = "")
@@ -137,8 +138,45 @@ namespace rpcmple
 				return true;
 			}
 
+			// Writes the segments as a single datagram
+			bool writeSegments(const segment* segments, size_t count) override
+			{
+				if (mSocket == INVALID_SOCKET)
+				{
+					spdlog::error("udpSocket: no open connection");
+					return false;
+				}
+
+				if (!clientAddr.sin_family)
+				{
+					spdlog::error("udpSocket: unknown destination address (nor previous connected client, nor specified server, nor broadcast)");
+					return false;
+				}
+
+				wsaBuffers.resize(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					wsaBuffers[i].buf = (CHAR*)segments[i].data;
+					wsaBuffers[i].len = (ULONG)segments[i].size;
+				}
+
+				DWORD bytesSent = 0;
+				if (WSASendTo(mSocket, wsaBuffers.data(), (DWORD)count, &bytesSent, 0, (sockaddr*)&clientAddr,
+				              sizeof(clientAddr), nullptr, nullptr) == SOCKET_ERROR)
+				{
+					spdlog::error("udpSocket: send failed with error: {}", WSAGetLastError());
+					return false;
+				}
+				return true;
+			}
+
 			// Reads data from the connected client
 			bool read(std::vector<uint8_t>& bytes, uint32_t* pBytesRead) override
+			{
+				return readInto(bytes.data(), bytes.size(), pBytesRead);
+			}
+
+			bool readInto(uint8_t* bytes, uint32_t size, uint32_t* pBytesRead) override
 			{
 				if(internalBufferStartPos == internalBufferEndPos) {
 					internalBufferStartPos = 0;
@@ -168,13 +206,13 @@ namespace rpcmple
 
 				int bytesInInternalBuffer = internalBufferEndPos - internalBufferStartPos;
 
-				if(bytes.size() <= bytesInInternalBuffer) {
-					std::copy(internalBuffer.begin() + internalBufferStartPos, internalBuffer.begin() + internalBufferStartPos + bytes.size(), bytes.begin());
-					internalBufferStartPos += bytes.size();
-					*pBytesRead = bytes.size();
+				if(size <= bytesInInternalBuffer) {
+					std::copy(internalBuffer.begin() + internalBufferStartPos, internalBuffer.begin() + internalBufferStartPos + size, bytes);
+					internalBufferStartPos += size;
+					*pBytesRead = size;
 					return true;
 				} else {
-					std::copy(internalBuffer.begin() + internalBufferStartPos, internalBuffer.begin() + internalBufferEndPos, bytes.begin());
+					std::copy(internalBuffer.begin() + internalBufferStartPos, internalBuffer.begin() + internalBufferEndPos, bytes);
 					internalBufferStartPos = 0;
 					internalBufferEndPos = 0;
 					*pBytesRead = bytesInInternalBuffer;
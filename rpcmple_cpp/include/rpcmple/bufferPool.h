@@ -0,0 +1,65 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+namespace rpcmple
+{
+	/* bufferPool recycles the frame buffers of a messageManager, so that once traffic is steady frames are written
+	 * to buffers which already have the capacity they need. It keeps up to maxBuffers buffers, and frees those
+	 * which have grown beyond maxCapacity bytes so that a single large frame does not stay allocated
+	 */
+	class bufferPool
+	{
+	private:
+		std::mutex mtx;
+		std::vector<std::vector<uint8_t>> buffers;
+		size_t maxBuffers;
+		size_t maxCapacity;
+
+	public:
+		explicit bufferPool(size_t maxBuffers = 64, size_t maxCapacity = 1048576)
+			: maxBuffers(maxBuffers), maxCapacity(maxCapacity)
+		{
+		}
+
+		// empty buffer, with the capacity of a recycled one when available
+		std::vector<uint8_t> acquire()
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			if (buffers.empty()) return {};
+			std::vector<uint8_t> buffer = std::move(buffers.back());
+			buffers.pop_back();
+			return buffer;
+		}
+
+		// takes back a buffer which is no longer used
+		void release(std::vector<uint8_t> buffer)
+		{
+			if (buffer.capacity() == 0 || buffer.capacity() > maxCapacity) return;
+			buffer.clear();
+			std::lock_guard<std::mutex> lock(mtx);
+			if (buffers.size() < maxBuffers) buffers.push_back(std::move(buffer));
+		}
+	};
+}
+
+#endif //BUFFERPOOL_H
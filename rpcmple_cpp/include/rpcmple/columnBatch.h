@@ -0,0 +1,253 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef COLUMNBATCH_H
+#define COLUMNBATCH_H
+
+#include "dataSignature.h"
+#include "rpcmple.h"
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace rpcmple
+{
+	/* columnBatch holds the records of a batch published by dataPublisher::publishBatch, one column per field of the
+	 * publisher signature. A batch is encoded column after column, each column as the array type of its field ('d' as
+	 * 'D', 's' as 'S', 'b' as 'B' and so on), so that the numbers of a column are contiguous and are encoded and
+	 * decoded as a whole. Only signatures of numbers and strings can be batched. Columns are views into the received
+	 * message, valid until the subscriber callback returns
+	 */
+	class columnBatch
+	{
+	private:
+		variantViewVector mColumns;
+		size_t mRows;
+
+		template<typename T, typename = void>
+		struct hasSize : std::false_type
+		{
+		};
+
+		template<typename T>
+		struct hasSize<T, std::void_t<decltype(std::declval<const T&>().size())>> : std::true_type
+		{
+		};
+
+		template<typename T>
+		struct isVector : std::false_type
+		{
+		};
+
+		template<typename T>
+		struct isVector<std::vector<T>> : std::true_type
+		{
+		};
+
+		template<typename T>
+		static bool gatherColumn(const std::vector<variantVector>& records, size_t begin, size_t end, size_t field,
+		                         variant& column)
+		{
+			std::vector<T> values;
+			values.reserve(end - begin);
+			for (size_t i = begin; i < end; i++)
+			{
+				const variant& val = records[i][field];
+				if (const T* pVal = std::get_if<T>(&val))
+				{
+					values.push_back(*pVal);
+					continue;
+				}
+				// as in records, a 'd' field accepts a float and 'i' and 'u' fields the narrower integers
+				if constexpr (std::is_same<T, double>::value)
+				{
+					if (const float* pFloat = std::get_if<float>(&val))
+					{
+						values.push_back(*pFloat);
+						continue;
+					}
+				}
+				if constexpr (std::is_same<T, int64_t>::value || std::is_same<T, uint64_t>::value)
+				{
+					T intVal;
+					if (heldInteger(val, &intVal))
+					{
+						values.push_back(intVal);
+						continue;
+					}
+				}
+				return false;
+			}
+			column = std::move(values);
+			return true;
+		}
+
+	public:
+		static constexpr uint32_t batchFrameFlag = 4;
+		// records of a single batch, which is the limit of the arrays its columns are encoded as
+		static constexpr size_t maxRows = 65535;
+
+		columnBatch() : mRows(0)
+		{
+		}
+
+		size_t rows() const { return mRows; }
+		size_t columns() const { return mColumns.size(); }
+
+		/* column of the field-th value of the signature, as the view its array type decodes to: arrayView<double> for
+		 * 'd', stringArrayView for 's', bitArrayView for 'b', varintArrayView for 'z'...
+		 */
+		const variantView& column(size_t field) const { return mColumns[field]; }
+
+		// writes the signature of the columns of a batch, returning false if the signature cannot be batched
+		static bool columnSignature(const dataSignature& signature, dataSignature& columns)
+		{
+			std::vector<char> chars;
+			columns = dataSignature();
+			for (size_t i = 0; i < signature.fieldCount(); i++)
+			{
+				char dataType = signature.fieldType(i);
+				switch (dataType)
+				{
+				case 'd':
+				case 'f':
+				case 'i':
+				case 'n':
+				case 'h':
+				case 'c':
+				case 'b':
+				case 'u':
+				case 'z':
+				case 'q':
+				case 's':
+				case 'l':
+				case 'w':
+					chars.push_back(static_cast<char>(dataType - 'a' + 'A'));
+					break;
+				default:
+					return false;
+				}
+			}
+			if (chars.empty()) return false;
+			columns = dataSignature(std::move(chars));
+			return true;
+		}
+
+		// number of values of a column held as a vector, or of a column view
+		template<typename V>
+		static size_t columnSize(const V& column)
+		{
+			return std::visit([](const auto& val) -> size_t
+			{
+				using T = std::decay_t<decltype(val)>;
+				if constexpr (hasSize<T>::value && !std::is_same<T, std::string_view>::value) return val.size();
+				else return SIZE_MAX;
+			}, column);
+		}
+
+		// transposes records [begin, end) into a vector per field of signature, returning false if a record does not
+		// match the signature
+		static bool toColumns(const dataSignature& signature, const std::vector<variantVector>& records, size_t begin,
+		                      size_t end, variantVector& columns)
+		{
+			size_t fieldCount = signature.fieldCount();
+			for (size_t i = begin; i < end; i++)
+			{
+				if (records[i].size() != fieldCount) return false;
+			}
+
+			columns.resize(fieldCount);
+			for (size_t field = 0; field < fieldCount; field++)
+			{
+				bool success;
+				switch (signature.fieldType(field))
+				{
+				case 'd':
+					success = gatherColumn<double>(records, begin, end, field, columns[field]);
+					break;
+				case 'f':
+					success = gatherColumn<float>(records, begin, end, field, columns[field]);
+					break;
+				case 'i':
+				case 'z':
+					success = gatherColumn<int64_t>(records, begin, end, field, columns[field]);
+					break;
+				case 'n':
+					success = gatherColumn<int32_t>(records, begin, end, field, columns[field]);
+					break;
+				case 'h':
+					success = gatherColumn<int16_t>(records, begin, end, field, columns[field]);
+					break;
+				case 'c':
+					success = gatherColumn<uint8_t>(records, begin, end, field, columns[field]);
+					break;
+				case 'b':
+					success = gatherColumn<bool>(records, begin, end, field, columns[field]);
+					break;
+				case 'u':
+				case 'q':
+					success = gatherColumn<uint64_t>(records, begin, end, field, columns[field]);
+					break;
+				case 's':
+				case 'l':
+					success = gatherColumn<std::string>(records, begin, end, field, columns[field]);
+					break;
+				case 'w':
+					success = gatherColumn<std::wstring>(records, begin, end, field, columns[field]);
+					break;
+				default:
+					success = false;
+				}
+				if (!success) return false;
+			}
+			return true;
+		}
+
+		// sets record to the row-th record of columns decoded by the column signature
+		static void toRecord(const variantVector& columns, size_t row, variantVector& record)
+		{
+			record.resize(columns.size());
+			for (size_t field = 0; field < columns.size(); field++)
+			{
+				std::visit([&record, field, row](const auto& column)
+				{
+					using T = std::decay_t<decltype(column)>;
+					if constexpr (isVector<T>::value)
+					{
+						record[field] = typename T::value_type(column[row]);
+					}
+				}, columns[field]);
+			}
+		}
+
+		// decodes the body of a batch frame encoded by the column signature, checking that columns are of equal size
+		bool decode(const dataSignature& columns, const uint8_t* body, size_t size)
+		{
+			mRows = 0;
+			if (!columns.fromBinaryView(body, size, mColumns) || mColumns.empty()) return false;
+
+			mRows = columnSize(mColumns[0]);
+			for (const variantView& column : mColumns)
+			{
+				if (columnSize(column) != mRows) return false;
+			}
+			return true;
+		}
+	};
+}
+
+#endif //COLUMNBATCH_H
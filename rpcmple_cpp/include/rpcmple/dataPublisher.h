@@ -19,13 +19,16 @@
 
 #include "messageManager.h"
 #include "dataSignature.h"
+#include "seriesCodec.h"
+#include "columnBatch.h"
 #include "rpcmple.h"
 
 #include <condition_variable>
 #include <mutex>
-#include <queue>
 #include <vector>
+#include <algorithm>
 #include <functional>
+#include <memory>
 
 namespace rpcmple
 {
@@ -33,18 +36,97 @@ namespace rpcmple
 	{
 	private:
 		dataSignature mSignature;
+		// signature of the columns of a batch, empty if mSignature cannot be batched
+		dataSignature mColumnSignature;
 
 		std::mutex stackMtx;
 		std::condition_variable cv;
-		std::queue<std::vector<uint8_t>> messageStack;
+		// queue of messages from stackHead on, kept in a vector so that queueing does not allocate once it has grown
+		std::vector<std::vector<uint8_t>> messageStack;
+		size_t stackHead;
+		// messages grouped after the first one, written from their own buffers and kept until the next writeMessage,
+		// once the previous group has been written
+		std::vector<std::vector<uint8_t>> groupedMessages;
 		bool stopWait;
 		bool groupMessages;
 
+		std::mutex seriesMtx;
+		std::unique_ptr<seriesCodec> series;
+
+		bool stackEmpty() const { return stackHead == messageStack.size(); }
+
+		void popStack()
+		{
+			stackHead++;
+			if (stackHead == messageStack.size())
+			{
+				messageStack.clear();
+				stackHead = 0;
+			}
+			else if (stackHead >= 64 && stackHead * 2 >= messageStack.size())
+			{
+				messageStack.erase(messageStack.begin(), messageStack.begin() + stackHead);
+				stackHead = 0;
+			}
+		}
+
+		// pushes a message whose first 4 bytes are reserved for the header, followed by the encoded data
+		bool pushMessage(std::vector<uint8_t>&& message, uint32_t flag = 1)
+		{
+			size_t bodySize = message.size() - frameHeaderSize;
+			if (bodySize > maxFrameBodySize)
+			{
+				spdlog::error("message size {} exceeding max allowed size {}", bodySize, maxFrameBodySize);
+				return false;
+			}
+
+			writeFrameHeader(flag, bodySize, message.data());
+
+			// in duplex mode the writer thread takes the message, see messageManager::enableDuplex
+			if (duplexEnabled()) return postMessage(std::move(message));
+
+			{
+				spdlog::debug("Publisher is locking resources and pushing new message");
+				std::lock_guard<std::mutex> stackLock(stackMtx);
+				messageStack.push_back(std::move(message));
+			}
+
+			cv.notify_all();
+			return true;
+		}
+
+		// pushes an encoded record, compressed by the series codec when enabled
+		bool pushRecord(std::vector<uint8_t>&& message)
+		{
+			std::lock_guard<std::mutex> seriesLock(seriesMtx);
+			if (!series) return pushMessage(std::move(message));
+
+			// frames must be queued in the order they were encoded
+			std::vector<uint8_t> frame = acquireBuffer();
+			uint32_t flag;
+			if (!series->encode(message.data() + 4, message.size() - 4, frame, 4, &flag))
+			{
+				spdlog::error("publisher: error compressing data");
+				return false;
+			}
+			releaseBuffer(std::move(message));
+			return pushMessage(std::move(frame), flag);
+		}
+
 	public:
 		dataPublisher(rpcmple::connectionManager::base* pConn, std::vector<char> signature, bool groupMessages = false)
 			: messageManager(pConn, true), mSignature(std::move(signature)), groupMessages(groupMessages)
 		{
 			stopWait = false;
+			stackHead = 0;
+			columnBatch::columnSignature(mSignature, mColumnSignature);
+		}
+
+		template<typename... Ts>
+		dataPublisher(rpcmple::connectionManager::base* pConn, typedSignature<Ts...> signature,
+		              bool groupMessages = false)
+			: dataPublisher(pConn, signature.chars(), groupMessages)
+		{
 		}
 
 		~dataPublisher() override
@@ -52,7 +134,7 @@ namespace rpcmple
 			stopDataFlow();
 		};
 
-		bool parseMessage(std::vector<uint8_t> message) override
+		bool parseMessage(const uint8_t* message, size_t size) override
 		{
 			return true;
 		}
@@ -64,9 +146,13 @@ namespace rpcmple
 			{
 				spdlog::debug("Publisher: locking connection resources and waiting for data");
 				std::unique_lock<std::mutex> lock(stackMtx);
-				if (messageStack.empty())
+				if (stackEmpty())
 				{
-					cv.wait(lock, [this] { return (!this->messageStack.empty() || this->stopWait); });
+					// messages held back by write coalescing are written before waiting for new ones
+					lock.unlock();
+					if (!flush()) return false;
+					lock.lock();
+					cv.wait(lock, [this] { return (!this->stackEmpty() || this->stopWait); });
 				}
 			}
 			std::thread::id tid = std::this_thread::get_id();
@@ -83,33 +169,32 @@ namespace rpcmple
 			{
 				std::lock_guard<std::mutex> lock(stackMtx);
 
-				unsigned int offset = 0;
+				// the previous group has been written
+				for (std::vector<uint8_t>& grouped : groupedMessages) releaseBuffer(std::move(grouped));
+				groupedMessages.clear();
 
 				bool grouping = true;
+				size_t groupSize = 0;
+				retMessage.clear();
 
-				while (grouping && !messageStack.empty() && retMessage.size() < 1024)
+				while (grouping && !stackEmpty() && groupSize < 1024)
 				{
 					grouping = groupMessages;
-					std::vector<uint8_t> stackMessage;
 
-					stackMessage = std::move(messageStack.front());
-					messageStack.pop();
-
-					if (stackMessage.size() > 16777216)
+					std::vector<uint8_t>& stackMessage = messageStack[stackHead];
+					groupSize += stackMessage.size();
+					if (retMessage.empty())
 					{
-						spdlog::error("message size {} exceeding max allowed size 16777216", stackMessage.size());
-						return false;
+						// retMessage's own buffer goes back to the pool
+						retMessage.swap(stackMessage);
+						releaseBuffer(std::move(stackMessage));
 					}
-
-					retMessage.resize(offset + 4 + stackMessage.size());
-
-					uint32_t callSuccessInt = 1;
-					uint32_t headerVal = callSuccessInt * 16777216 + stackMessage.size();
-					uint32ToBytes(headerVal, retMessage.data() + offset, true);
-					offset += 4;
-
-					std::copy(stackMessage.begin(), stackMessage.end(), retMessage.data() + offset);
-					offset += stackMessage.size();
+					else
+					{
+						appendSegment(retMessage, stackMessage.data(), stackMessage.size());
+						groupedMessages.push_back(std::move(stackMessage));
+					}
+					popStack();
 				}
 			}
 			cv.notify_all();
@@ -129,36 +214,130 @@ namespace rpcmple
 
 		bool publish(variantVector& data)
 		{
-			if (data.size() != mSignature.size())
+			if (data.size() != mSignature.fieldCount())
 			{
 				spdlog::error("publisher: invalid number of arguments");
 				return false;
 			}
 
-			std::vector<uint8_t> message(1024);
-			if (!mSignature.toBinary(data, message))
+			std::vector<uint8_t> message = acquireBuffer();
+			if (!mSignature.toBinary(data, message, 4))
 			{
 				spdlog::error("publisher: error translating variables to binary");
 				return false;
 			}
 
+			return pushRecord(std::move(message));
+		}
+
+		// publish data encoded through typedSignature<Ts...>, which must match the publisher signature
+		template<typename... Ts>
+		bool publish(const std::tuple<Ts...>& data)
+		{
+			if (!typedSignature<Ts...>::matches(mSignature.chars()))
 			{
-				spdlog::debug("Publisher is locking resources and pushing new message");
-				std::lock_guard<std::mutex> stackLock(stackMtx);
-				messageStack.push(message);
+				spdlog::error("publisher: typed data does not match publisher signature");
+				return false;
 			}
 
-			cv.notify_all();
+			std::vector<uint8_t> message = acquireBuffer();
+			if (!typedSignature<Ts...>::toBinary(data, message, 4))
+			{
+				spdlog::error("publisher: error translating variables to binary");
+				return false;
+			}
+
+			return pushRecord(std::move(message));
+		}
+
+		/* publishes records as column batches, which the subscriber receives as columnBatch. A batch holds up to
+		 * columnBatch::maxRows records, more records are split in several batches. Only signatures of numbers and
+		 * strings can be batched. Batches are not series compressed
+		 */
+		bool publishBatch(const std::vector<variantVector>& records)
+		{
+			if (mColumnSignature.empty())
+			{
+				spdlog::error("publisher: batches require a signature of numbers and strings");
+				return false;
+			}
+
+			variantVector columns;
+			for (size_t begin = 0; begin < records.size(); begin += columnBatch::maxRows)
+			{
+				size_t end = std::min(records.size(), begin + columnBatch::maxRows);
+				if (!columnBatch::toColumns(mSignature, records, begin, end, columns))
+				{
+					spdlog::error("publisher: batch records do not match publisher signature");
+					return false;
+				}
+				if (!publishColumns(columns)) return false;
+			}
+			return true;
+		}
+
+		// publishes a batch given as its columns, one std::vector of the field type per field, all of the same size
+		bool publishColumns(const variantVector& columns)
+		{
+			if (mColumnSignature.empty())
+			{
+				spdlog::error("publisher: batches require a signature of numbers and strings");
+				return false;
+			}
+			if (columns.size() != mColumnSignature.size())
+			{
+				spdlog::error("publisher: invalid number of columns");
+				return false;
+			}
+			for (const variant& column : columns)
+			{
+				if (columnBatch::columnSize(column) != columnBatch::columnSize(columns[0]))
+				{
+					spdlog::error("publisher: batch columns are not of the same size");
+					return false;
+				}
+			}
+
+			std::vector<uint8_t> message = acquireBuffer();
+			if (!mColumnSignature.toBinary(columns, message, 4))
+			{
+				spdlog::error("publisher: error translating columns to binary");
+				return false;
+			}
+
+			return pushMessage(std::move(message), columnBatch::batchFrameFlag);
+		}
+
+		/* compresses the published records with seriesCodec, sending a keyframe every keyframeInterval records. The
+		 * subscriber decompresses them without configuration. Only signatures of numbers and arrays of numbers can be
+		 * compressed
+		 */
+		bool enableSeriesCompression(uint32_t keyframeInterval = 64)
+		{
+			if (!seriesCodec::isSupported(mSignature.chars()))
+			{
+				spdlog::error("publisher: series compression requires a signature of 'd', 'i', 'u' and their arrays");
+				return false;
+			}
+			std::lock_guard<std::mutex> seriesLock(seriesMtx);
+			series = std::make_unique<seriesCodec>(mSignature.chars(), keyframeInterval);
 			return true;
 		}
 
 		void waitPublishComplete()
 		{
+			if (duplexEnabled())
+			{
+				spdlog::debug("publisher: waiting until all messages are written");
+				waitWritten();
+				return;
+			}
+
 			{
 				spdlog::debug("publisher: waiting until all messages are published");
 				std::unique_lock<std::mutex> lock(stackMtx);
-				if (messageStack.empty()) return;
-				cv.wait(lock, [this] { return this->messageStack.empty() || this->stopWait; });
+				if (stackEmpty()) return;
+				cv.wait(lock, [this] { return this->stackEmpty() || this->stopWait; });
 			}
 		}
 	};
@@ -21,794 +21,3160 @@
 #include <string>
 #include <cstdint>
 #include <vector>
-#include <codecvt>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <string_view>
+#include <initializer_list>
 
 #include "rpcmple.h"
 
 namespace rpcmple
 {
-	typedef std::variant<int64_t, uint64_t, double, std::wstring, std::string, std::vector<int64_t>, std::vector<
-		                     uint64_t>, std::vector<double>, std::vector<std::wstring>, std::vector<std::string>>
-	variant;
-	typedef std::vector<variant> variantVector;
-
-	inline bool getVariantValue(const variant& val, int64_t* pRetVal)
+	// strings and arrays are prefixed by their length, 16 bit for the base type codes and 32 bit for the wide ones
+	inline constexpr size_t lengthSize(bool wide)
 	{
-		if (!std::holds_alternative<int64_t>(val))
-		{
-			return false;
-		}
+		return wide ? 4 : 2;
+	}
 
-		*pRetVal = std::get<int64_t>(val);
-		return true;
+	inline constexpr size_t maxLength(bool wide)
+	{
+		return wide ? 0xFFFFFFFF : 65535;
 	}
 
-	inline bool getVariantValue(const variant& val, uint64_t* pRetVal)
+	inline uint8_t* writeLength(size_t length, bool wide, uint8_t* message)
 	{
-		if (!std::holds_alternative<uint64_t>(val))
-		{
-			return false;
-		}
+		if (wide) uint32ToBytes(length, message, true);
+		else uint16ToBytes(length, message, true);
+		return message + lengthSize(wide);
+	}
 
-		*pRetVal = std::get<uint64_t>(val);
-		return true;
+	inline size_t peekLength(const uint8_t* message, bool wide)
+	{
+		return wide ? bytesToUint32(message, true) : bytesToUint16(message, true);
 	}
 
-	inline bool getVariantValue(const variant& val, double* pRetVal)
+	inline bool readLength(const uint8_t* message, size_t size, size_t& offset, bool wide, size_t* pLength)
 	{
-		if (!std::holds_alternative<double>(val))
+		if (size - offset < lengthSize(wide))
 		{
+			spdlog::error("cannot deserialize message: incomplete");
 			return false;
 		}
-
-		*pRetVal = std::get<double>(val);
+		*pLength = peekLength(message + offset, wide);
+		offset += lengthSize(wide);
 		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::wstring* pRetVal)
+	/* Fixed size numbers are stored little endian in 8 bytes ('d' double, 'i' int64_t, 'u' uint64_t) or in their own
+	 * narrow size ('f' float, 'n' int32_t, 'h' int16_t, 'c' uint8_t, 'b' bool as a 0 or 1 byte). Returns 0 for the
+	 * other type codes
+	 */
+	inline constexpr size_t fixedSize(char dataType)
 	{
-		if (!std::holds_alternative<std::wstring>(val))
+		switch (dataType)
 		{
-			return false;
+		case 'd':
+		case 'i':
+		case 'u':
+			return 8;
+		case 'f':
+		case 'n':
+			return 4;
+		case 'h':
+			return 2;
+		case 'c':
+		case 'b':
+			return 1;
+		default:
+			return 0;
 		}
+	}
 
-		*pRetVal = std::get<std::wstring>(val);
+	/* reads the integer held by val, a variant or a recordField, for an 'i' or 'z' field. A variant built from an int
+	 * or a short holds an int32_t or an int16_t, so the narrower integers are widened as 'd' takes a float
+	 */
+	template<typename V>
+	inline bool heldInteger(const V& val, int64_t* pValue)
+	{
+		if (const int64_t* pInt64 = std::get_if<int64_t>(&val)) *pValue = *pInt64;
+		else if (const int32_t* pInt32 = std::get_if<int32_t>(&val)) *pValue = *pInt32;
+		else if (const int16_t* pInt16 = std::get_if<int16_t>(&val)) *pValue = *pInt16;
+		else if (const uint8_t* pUint8 = std::get_if<uint8_t>(&val)) *pValue = *pUint8;
+		else return false;
 		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::string* pRetVal)
+	// reads the integer held by val for a 'u' or 'q' field, widening a uint8_t
+	template<typename V>
+	inline bool heldInteger(const V& val, uint64_t* pValue)
 	{
-		if (!std::holds_alternative<std::string>(val))
-		{
-			return false;
-		}
-
-		*pRetVal = std::get<std::string>(val);
+		if (const uint64_t* pUint64 = std::get_if<uint64_t>(&val)) *pValue = *pUint64;
+		else if (const uint8_t* pUint8 = std::get_if<uint8_t>(&val)) *pValue = *pUint8;
+		else return false;
 		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::vector<int64_t>* pRetVal)
+	/* tells whether val, a variant or a recordField, holds a fixed size number of dataType. 'd' also takes a float,
+	 * 'i' and 'u' the narrower integers, see heldInteger
+	 */
+	template<typename V>
+	inline bool holdsFixed(char dataType, const V& val)
 	{
-		if (!std::holds_alternative<std::vector<int64_t>>(val))
+		int64_t intVal;
+		uint64_t uintVal;
+		switch (dataType)
 		{
+		case 'd':
+			return std::holds_alternative<double>(val) || std::holds_alternative<float>(val);
+		case 'i':
+			return heldInteger(val, &intVal);
+		case 'u':
+			return heldInteger(val, &uintVal);
+		case 'f':
+			return std::holds_alternative<float>(val);
+		case 'n':
+			return std::holds_alternative<int32_t>(val);
+		case 'h':
+			return std::holds_alternative<int16_t>(val);
+		case 'c':
+			return std::holds_alternative<uint8_t>(val);
+		case 'b':
+			return std::holds_alternative<bool>(val);
+		default:
 			return false;
 		}
-
-		*pRetVal = std::get<std::vector<int64_t>>(val);
-		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::vector<uint64_t>* pRetVal)
+	// writes the fixed size number held by val, which must have been checked by holdsFixed
+	template<typename V>
+	inline void encodeFixed(char dataType, const V& val, uint8_t* message)
 	{
-		if (!std::holds_alternative<std::vector<uint64_t>>(val))
+		switch (dataType)
 		{
-			return false;
+		case 'd':
+			if (const double* pDbl = std::get_if<double>(&val)) doubleToBytes(*pDbl, message, true);
+			else doubleToBytes(*std::get_if<float>(&val), message, true);
+			break;
+		case 'i':
+			{
+				int64_t intVal = 0;
+				heldInteger(val, &intVal);
+				int64ToBytes(intVal, message, true);
+				break;
+			}
+		case 'u':
+			{
+				uint64_t uintVal = 0;
+				heldInteger(val, &uintVal);
+				uint64ToBytes(uintVal, message, true);
+				break;
+			}
+		case 'f':
+			encodeArrayLE(std::get_if<float>(&val), 1, message);
+			break;
+		case 'n':
+			encodeArrayLE(std::get_if<int32_t>(&val), 1, message);
+			break;
+		case 'h':
+			encodeArrayLE(std::get_if<int16_t>(&val), 1, message);
+			break;
+		case 'c':
+			*message = *std::get_if<uint8_t>(&val);
+			break;
+		default:
+			*message = *std::get_if<bool>(&val) ? 1 : 0;
+			break;
 		}
-
-		*pRetVal = std::get<std::vector<uint64_t>>(val);
-		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::vector<double>* pRetVal)
+	// reads a fixed size number of dataType to val, which can be a variant, a variantView or a recordField
+	template<typename V>
+	inline void decodeFixed(char dataType, const uint8_t* message, V& val)
 	{
-		if (!std::holds_alternative<std::vector<double>>(val))
+		switch (dataType)
 		{
-			return false;
+		case 'd':
+			val = bytesToDouble(message, true);
+			break;
+		case 'i':
+			val = bytesToInt64(message, true);
+			break;
+		case 'u':
+			val = bytesToUint64(message, true);
+			break;
+		case 'f':
+			{
+				float fltVal;
+				decodeArrayLE(message, 1, &fltVal);
+				val = fltVal;
+				break;
+			}
+		case 'n':
+			{
+				int32_t intVal;
+				decodeArrayLE(message, 1, &intVal);
+				val = intVal;
+				break;
+			}
+		case 'h':
+			{
+				int16_t intVal;
+				decodeArrayLE(message, 1, &intVal);
+				val = intVal;
+				break;
+			}
+		case 'c':
+			val = message[0];
+			break;
+		default:
+			val = message[0] != 0;
+			break;
 		}
-
-		*pRetVal = std::get<std::vector<double>>(val);
-		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::vector<std::wstring>* pRetVal)
+	/* Arrays of tuples ('[' ']') hold records whose fields are numbers or strings: 'd', 'i', 'u', 'f', 'n', 'h', 'c',
+	 * 'b', 'z', 'q', 's', 'l' and 'w'. A decoded field is held by recordField, 's' and 'l' as std::string, 'w' as
+	 * std::wstring
+	 */
+	typedef std::variant<int64_t, uint64_t, double, std::wstring, std::string, float, int32_t, int16_t, uint8_t, bool>
+	recordField;
+
+	inline constexpr bool isRecordFieldType(char dataType)
 	{
-		if (!std::holds_alternative<std::vector<std::wstring>>(val))
+		if (fixedSize(dataType) > 0) return true;
+
+		switch (dataType)
 		{
+		case 'z':
+		case 'q':
+		case 's':
+		case 'l':
+		case 'w':
+			return true;
+		default:
 			return false;
 		}
-
-		*pRetVal = std::get<std::vector<std::wstring>>(val);
-		return true;
 	}
 
-	inline bool getVariantValue(const variant& val, std::vector<std::string>* pRetVal)
+	// adds the encoded size of a record field to *pSize. Returns false if val does not hold dataType
+	inline bool recordFieldSize(char dataType, const recordField& val, size_t* pSize)
 	{
-		if (!std::holds_alternative<std::vector<std::string>>(val))
+		if (fixedSize(dataType) > 0)
 		{
-			return false;
+			*pSize += fixedSize(dataType);
+			return holdsFixed(dataType, val);
 		}
 
-		*pRetVal = std::get<std::vector<std::string>>(val);
-		return true;
+		int64_t intVal;
+		uint64_t uintVal;
+		switch (dataType)
+		{
+		case 'z':
+			if (!heldInteger(val, &intVal)) return false;
+			*pSize += varintSize(zigzagEncode(intVal));
+			return true;
+		case 'q':
+			if (!heldInteger(val, &uintVal)) return false;
+			*pSize += varintSize(uintVal);
+			return true;
+		case 's':
+		case 'l':
+			{
+				if (!std::holds_alternative<std::string>(val)) return false;
+				bool wide = dataType == 'l';
+				size_t strSize = std::get_if<std::string>(&val)->size();
+				if (strSize > maxLength(wide))
+				{
+					spdlog::error("string size {} exceeding max allowed size {}", strSize, maxLength(wide));
+					return false;
+				}
+				*pSize += lengthSize(wide) + strSize;
+				return true;
+			}
+		case 'w':
+			{
+				if (!std::holds_alternative<std::wstring>(val)) return false;
+				size_t strSize = utf8Length(*std::get_if<std::wstring>(&val));
+				if (strSize > 65535)
+				{
+					spdlog::error("string size {} exceeding max allowed size 65535", strSize);
+					return false;
+				}
+				*pSize += 2 + strSize;
+				return true;
+			}
+		default:
+			return false;
+		}
 	}
 
-	class dataSignature : public std::vector<char>
+	// writes a record field, which must have been checked by recordFieldSize
+	inline uint8_t* encodeRecordField(char dataType, const recordField& val, uint8_t* message)
 	{
-	private:
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-
-	public:
-		dataSignature() : std::vector<char>()
+		if (fixedSize(dataType) > 0)
 		{
+			encodeFixed(dataType, val, message);
+			return message + fixedSize(dataType);
 		}
 
-		explicit dataSignature(std::vector<char> vec) : std::vector<char>(vec)
+		int64_t intVal = 0;
+		uint64_t uintVal = 0;
+		switch (dataType)
 		{
+		case 'z':
+			heldInteger(val, &intVal);
+			return encodeVarint(zigzagEncode(intVal), message);
+		case 'q':
+			heldInteger(val, &uintVal);
+			return encodeVarint(uintVal, message);
+		case 'w':
+			{
+				const std::wstring& wstrVal = *std::get_if<std::wstring>(&val);
+				uint8_t* end = encodeUtf8(wstrVal.data(), wstrVal.size(), message + 2);
+				uint16ToBytes(end - message - 2, message, true);
+				return end;
+			}
+		default:
+			{
+				const std::string& strVal = *std::get_if<std::string>(&val);
+				message = writeLength(strVal.size(), dataType == 'l', message);
+				if (!strVal.empty()) std::memcpy(message, strVal.data(), strVal.size());
+				return message + strVal.size();
+			}
 		}
+	}
 
-		bool toBinary(variantVector& rets, std::vector<uint8_t>& message)
+	// reads a record field at message[offset] to *pVal, or only skips it when pVal is null
+	inline bool decodeRecordField(char dataType, const uint8_t* message, size_t size, size_t& offset, recordField* pVal)
+	{
+		if (size_t valSize = fixedSize(dataType))
 		{
-			int replyOffset = 0;
-
-			for (int i = 0; i < this->size(); i++)
+			if (size - offset < valSize)
 			{
-				char dataType = this->at(i);
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			if (pVal) decodeFixed(dataType, message + offset, *pVal);
+			offset += valSize;
+			return true;
+		}
 
-				switch (dataType)
+		switch (dataType)
+		{
+		case 'z':
+		case 'q':
+			{
+				uint64_t uintVal;
+				if (!decodeVarint(message, size, offset, &uintVal))
 				{
-				case 'v':
-					if (std::holds_alternative<double>(rets[i])) dataType = 'd';
-					else if (std::holds_alternative<vector<double>>(rets[i])) dataType = 'D';
-					else if (std::holds_alternative<int64_t>(rets[i])) dataType = 'i';
-					else if (std::holds_alternative<vector<int64_t>>(rets[i])) dataType = 'I';
-					else if (std::holds_alternative<uint64_t>(rets[i])) dataType = 'u';
-					else if (std::holds_alternative<vector<uint64_t>>(rets[i])) dataType = 'U';
-					else if (std::holds_alternative<std::string>(rets[i])) dataType = 's';
-					else if (std::holds_alternative<vector<std::string>>(rets[i])) dataType = 'S';
-					else if (std::holds_alternative<std::wstring>(rets[i])) dataType = 'w';
-					else if (std::holds_alternative<vector<std::wstring>>(rets[i])) dataType = 'W';
-					else return false;
-
-					if (message.size() < replyOffset + 1)
-					{
-						message.resize(message.size() + 1);
-					}
-
-					char dataTypeW = dataType;
-					if (dataTypeW == 'w') dataTypeW = 's';
-					if (dataTypeW == 'W') dataTypeW = 'S';
-					std::memcpy(message.data() + replyOffset, &dataTypeW, 1);
-					replyOffset += 1;
-					break;
+					spdlog::error("cannot deserialize message: incomplete");
+					return false;
+				}
+				if (pVal)
+				{
+					if (dataType == 'z') *pVal = zigzagDecode(uintVal);
+					else *pVal = uintVal;
 				}
+				return true;
+			}
+		default:
+			{
+				size_t strSize;
+				if (!readLength(message, size, offset, dataType == 'l', &strSize)) return false;
 
-				switch (dataType)
+				if (size - offset < strSize)
 				{
-				case 'd':
+					spdlog::error("cannot deserialize message: incomplete");
+					return false;
+				}
+				if (pVal && dataType == 'w')
+				{
+					// decodes in place, reusing the capacity of a string already held
+					if (!std::holds_alternative<std::wstring>(*pVal)) *pVal = std::wstring();
+					if (!decodeUtf8(message + offset, strSize, *std::get_if<std::wstring>(pVal)))
 					{
-						double dblVal;
-						bool success = getVariantValue(rets[i], &dblVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						if (message.size() < replyOffset + 8)
-						{
-							message.resize(message.size() + 8);
-						}
-						doubleToBytes(dblVal, message.data() + replyOffset, true);
-						replyOffset += 8;
-						break;
+						spdlog::error("cannot deserialize message: invalid UTF-8 string");
+						return false;
 					}
-				case 'D':
-					{
-						std::vector<double> dblArr;
-						bool success = getVariantValue(rets[i], &dblArr);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
+				}
+				else if (pVal)
+				{
+					if (!std::holds_alternative<std::string>(*pVal)) *pVal = std::string();
+					std::get_if<std::string>(pVal)->assign(reinterpret_cast<const char*>(message) + offset, strSize);
+				}
+				offset += strSize;
+				return true;
+			}
+		}
+	}
 
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+	/* recordArray holds the records of an array of tuples in a single contiguous vector, record after record.
+	 * records[i] points to the fieldCount() fields of record i
+	 */
+	class recordArray
+	{
+	private:
+		size_t mFieldCount;
+		std::vector<recordField> mFields;
 
-						if (dblArr.size() > 65536)
-						{
-							spdlog::error("array size {} exceeding max allowed size 65536", dblArr.size());
-							return false;
-						}
-						uint16_t dblArrSize = dblArr.size();
-						uint16ToBytes(dblArrSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+	public:
+		recordArray() : mFieldCount(0)
+		{
+		}
 
-						for (int j = 0; j < dblArrSize; j++)
-						{
-							if (message.size() < replyOffset + 8)
-							{
-								message.resize(message.size() + 8);
-							}
-							doubleToBytes(dblArr[j], message.data() + replyOffset, true);
-							replyOffset += 8;
-						}
-						break;
-					}
-				case 'i':
-					{
-						int64_t intVal;
-						bool success = getVariantValue(rets[i], &intVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						if (message.size() < replyOffset + 8)
-						{
-							message.resize(message.size() + 8);
-						}
-						int64ToBytes(intVal, message.data() + replyOffset, true);
-						replyOffset += 8;
-						break;
-					}
-				case 'I':
-					{
-						std::vector<int64_t> intArr;
-						bool success = getVariantValue(rets[i], &intArr);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+		explicit recordArray(size_t fieldCount, size_t size = 0) : mFieldCount(fieldCount), mFields(fieldCount * size)
+		{
+		}
 
-						if (intArr.size() > 65536)
-						{
-							spdlog::error("array size {} exceeding max allowed size 65536", intArr.size());
-							return false;
-						}
-						uint16_t intArrSize = intArr.size();
-						uint16ToBytes(intArrSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+		size_t size() const { return mFieldCount > 0 ? mFields.size() / mFieldCount : 0; }
+		bool empty() const { return mFields.empty(); }
+		size_t fieldCount() const { return mFieldCount; }
 
-						for (int j = 0; j < intArrSize; j++)
-						{
-							if (message.size() < replyOffset + 8)
-							{
-								message.resize(message.size() + 8);
-							}
-							int64ToBytes(intArr[j], message.data() + replyOffset, true);
-							replyOffset += 8;
-						}
-						break;
-					}
-				case 'u':
-					{
-						uint64_t uintVal;
-						bool success = getVariantValue(rets[i], &uintVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						if (message.size() < replyOffset + 8)
-						{
-							message.resize(message.size() + 8);
-						}
-						uint64ToBytes(uintVal, message.data() + replyOffset, true);
-						replyOffset += 8;
-						break;
-					}
-				case 'U':
-					{
-						std::vector<uint64_t> uintArr;
-						bool success = getVariantValue(rets[i], &uintArr);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+		recordField* operator[](size_t i) { return mFields.data() + i * mFieldCount; }
+		const recordField* operator[](size_t i) const { return mFields.data() + i * mFieldCount; }
 
-						if (uintArr.size() > 65536)
-						{
-							spdlog::error("array size {} exceeding max allowed size 65536", uintArr.size());
-							return false;
-						}
-						uint16_t uintArrSize = uintArr.size();
-						uint16ToBytes(uintArrSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+		std::vector<recordField>& fields() { return mFields; }
+		const std::vector<recordField>& fields() const { return mFields; }
 
-						for (int j = 0; j < uintArrSize; j++)
-						{
-							if (message.size() < replyOffset + 8)
-							{
-								message.resize(message.size() + 8);
-							}
-							uint64ToBytes(uintArr[j], message.data() + replyOffset, true);
-							replyOffset += 8;
-						}
-						break;
-					}
-				case 'w':
-					{
-						std::wstring wstrVal;
-						bool success = getVariantValue(rets[i], &wstrVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
-						std::string strVal = converter.to_bytes(wstrVal);
+		void resize(size_t size) { mFields.resize(size * mFieldCount); }
+		void reserve(size_t size) { mFields.reserve(size * mFieldCount); }
 
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+		// appends a record, which must hold fieldCount() fields
+		bool append(std::initializer_list<recordField> record)
+		{
+			if (record.size() != mFieldCount)
+			{
+				spdlog::error("record size {} not matching field count {}", record.size(), mFieldCount);
+				return false;
+			}
+			mFields.insert(mFields.end(), record);
+			return true;
+		}
 
-						if (strVal.size() > 65536)
-						{
-							spdlog::error("string size {} exceeding max allowed size 65536", strVal.size());
-							return false;
-						}
-						uint16_t strSize = strVal.size();
-						uint16ToBytes(strSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+		bool operator==(const recordArray& other) const
+		{
+			return mFieldCount == other.mFieldCount && mFields == other.mFields;
+		}
 
-						if (message.size() < replyOffset + strSize)
-						{
-							message.resize(message.size() + strSize);
-						}
-						std::copy(strVal.begin(), strVal.end(), message.data() + replyOffset);
-						replyOffset += strSize;
-						break;
-					}
-				case 'W':
-					{
-						std::vector<std::wstring> wstrArrVal;
-						bool success = getVariantValue(rets[i], &wstrArrVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
+		bool operator!=(const recordArray& other) const { return !(*this == other); }
+	};
 
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+	/* recordArrayView is a non-owning view over an array of tuples as found in a received message. Records are decoded
+	 * by copyTo and toRecordArray. fieldTypes points into the dataSignature which decoded the view
+	 */
+	class recordArrayView
+	{
+	private:
+		const uint8_t* mBegin;
+		const uint8_t* mEnd;
+		size_t mSize;
+		std::string_view mFieldTypes;
 
-						if (wstrArrVal.size() > 65536)
-						{
-							spdlog::error("array size {} exceeding max allowed size 65536", wstrArrVal.size());
-							return false;
-						}
-						uint16_t arrSize = wstrArrVal.size();
-						uint16ToBytes(arrSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+	public:
+		recordArrayView() : mBegin(nullptr), mEnd(nullptr), mSize(0)
+		{
+		}
 
-						for (int j = 0; j < arrSize; j++)
-						{
-							std::wstring wstrVal = wstrArrVal[j];
-							std::string strVal = converter.to_bytes(wstrVal);
+		recordArrayView(const uint8_t* begin, const uint8_t* end, size_t size, std::string_view fieldTypes)
+			: mBegin(begin), mEnd(end), mSize(size), mFieldTypes(fieldTypes)
+		{
+		}
 
-							if (message.size() < replyOffset + 2)
-							{
-								message.resize(message.size() + 2);
-							}
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		size_t fieldCount() const { return mFieldTypes.size(); }
+		std::string_view fieldTypes() const { return mFieldTypes; }
+		const uint8_t* bytes() const { return mBegin; }
+		size_t byteSize() const { return mEnd - mBegin; }
 
-							if (strVal.size() > 65536)
-							{
-								spdlog::error("string size {} exceeding max allowed size 65536", strVal.size());
-								return false;
-							}
-							uint16_t strSize = strVal.size();
-							uint16ToBytes(strSize, message.data() + replyOffset, true);
-							replyOffset += 2;
+		bool copyTo(recordArray& records) const
+		{
+			if (records.fieldCount() != mFieldTypes.size()) records = recordArray(mFieldTypes.size());
+			records.resize(mSize);
 
-							if (message.size() < replyOffset + strSize)
-							{
-								message.resize(message.size() + strSize);
-							}
-							std::copy(strVal.begin(), strVal.end(), message.data() + replyOffset);
-							replyOffset += strSize;
-						}
-						break;
-					}
-				case 's':
-					{
-						std::string strVal;
-						bool success = getVariantValue(rets[i], &strVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
+			size_t offset = 0;
+			for (size_t i = 0; i < mSize; i++)
+			{
+				recordField* record = records[i];
+				for (size_t j = 0; j < mFieldTypes.size(); j++)
+				{
+					if (!decodeRecordField(mFieldTypes[j], mBegin, mEnd - mBegin, offset, record + j)) return false;
+				}
+			}
+			return true;
+		}
 
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+		recordArray toRecordArray() const
+		{
+			recordArray records;
+			copyTo(records);
+			return records;
+		}
+	};
 
-						if (strVal.size() > 65536)
-						{
-							spdlog::error("string size {} exceeding max allowed size 65536", strVal.size());
-							return false;
-						}
-						uint16_t strSize = strVal.size();
-						uint16ToBytes(strSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+	/* arrayView is a non-owning view over an array of numbers as found in a received message, stored as unaligned
+	 * little endian bytes. Elements are converted on access
+	 */
+	template<typename T>
+	class arrayView
+	{
+	private:
+		const uint8_t* mData;
+		size_t mSize;
 
-						if (message.size() < replyOffset + strSize)
-						{
-							message.resize(message.size() + strSize);
-						}
-						std::copy(strVal.begin(), strVal.end(), message.data() + replyOffset);
-						replyOffset += strSize;
-						break;
-					}
-				case 'S':
-					{
-						std::vector<std::string> strArrVal;
-						bool success = getVariantValue(rets[i], &strArrVal);
-						if (!success)
-						{
-							spdlog::error("error converting variant, signature / values mismatch");
-							return false;
-						}
+	public:
+		arrayView() : mData(nullptr), mSize(0)
+		{
+		}
 
-						if (message.size() < replyOffset + 2)
-						{
-							message.resize(message.size() + 2);
-						}
+		arrayView(const uint8_t* data, size_t size) : mData(data), mSize(size)
+		{
+		}
 
-						if (strArrVal.size() > 65536)
-						{
-							spdlog::error("string size {} exceeding max allowed size 65536", strArrVal.size());
-							return false;
-						}
-						uint16_t arrSize = strArrVal.size();
-						uint16ToBytes(arrSize, message.data() + replyOffset, true);
-						replyOffset += 2;
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		const uint8_t* bytes() const { return mData; }
 
-						for (int j = 0; j < arrSize; j++)
-						{
-							std::string strVal = strArrVal[j];
+		T operator[](size_t i) const
+		{
+			T val;
+			decodeArrayLE(mData + i * sizeof(T), 1, &val);
+			return val;
+		}
 
-							if (message.size() < replyOffset + 2)
-							{
-								message.resize(message.size() + 2);
-							}
+		void copyTo(T* dst) const
+		{
+			decodeArrayLE(mData, mSize, dst);
+		}
 
-							if (strVal.size() > 65536)
-							{
-								spdlog::error("string size {} exceeding max allowed size 65536", strVal.size());
-								return false;
-							}
-							uint16_t strSize = strVal.size();
-							uint16ToBytes(strSize, message.data() + replyOffset, true);
-							replyOffset += 2;
+		std::vector<T> toVector() const
+		{
+			std::vector<T> vec(mSize);
+			copyTo(vec.data());
+			return vec;
+		}
+	};
 
-							if (message.size() < replyOffset + strSize)
-							{
-								message.resize(message.size() + strSize);
-							}
-							std::copy(strVal.begin(), strVal.end(), message.data() + replyOffset);
-							replyOffset += strSize;
-						}
-						break;
-					}
-				default:
-					{
-						spdlog::error("invalid signature {}", dataType);
-						return false;
-					}
-				}
+	/* byteView is a non-owning span of bytes. Held by a variant, it is sent as a binary blob ('x') straight from the
+	 * caller's memory, without copying it to a std::vector<uint8_t> first. The bytes must stay valid until the value
+	 * is encoded: until publish or call return, or until a procedure returning it has returned
+	 */
+	typedef arrayView<uint8_t> byteView;
+
+	typedef std::variant<int64_t, uint64_t, double, std::wstring, std::string, std::vector<int64_t>, std::vector<
+		                     uint64_t>, std::vector<double>, std::vector<std::wstring>, std::vector<std::string>,
+	                     std::vector<uint8_t>, recordArray, byteView, float, int32_t, int16_t, uint8_t, bool, std::vector<
+		                     float>, std::vector<int32_t>, std::vector<int16_t>, std::vector<bool>>
+	variant;
+	typedef std::vector<variant> variantVector;
+
+	/* stringArrayView is a non-owning view over an array of length prefixed UTF-8 strings as found in a received
+	 * message. Strings are visited in order through its iterator
+	 */
+	class stringArrayView
+	{
+	private:
+		const uint8_t* mBegin;
+		const uint8_t* mEnd;
+		size_t mSize;
+		bool mWide;
+
+	public:
+		class iterator
+		{
+		private:
+			const uint8_t* mPos;
+			bool mWide;
+
+		public:
+			iterator(const uint8_t* pos, bool wide) : mPos(pos), mWide(wide)
+			{
 			}
-			message.resize(replyOffset);
-			return true;
+
+			std::string_view operator*() const
+			{
+				return {reinterpret_cast<const char*>(mPos + lengthSize(mWide)), peekLength(mPos, mWide)};
+			}
+
+			iterator& operator++()
+			{
+				mPos += lengthSize(mWide) + peekLength(mPos, mWide);
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const { return mPos == other.mPos; }
+			bool operator!=(const iterator& other) const { return mPos != other.mPos; }
+		};
+
+		stringArrayView() : mBegin(nullptr), mEnd(nullptr), mSize(0), mWide(false)
+		{
 		}
 
-		bool fromBinary(std::vector<uint8_t>& message, variantVector& args)
+		stringArrayView(const uint8_t* begin, const uint8_t* end, size_t size, bool wide = false) : mBegin(begin),
+			mEnd(end), mSize(size), mWide(wide)
 		{
-			int messageOffset = 0;
-			args.resize(this->size());
+		}
 
-			for (auto i = 0; i < this->size(); i++)
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		iterator begin() const { return iterator(mBegin, mWide); }
+		iterator end() const { return iterator(mEnd, mWide); }
+
+		std::vector<std::string> toVector() const
+		{
+			std::vector<std::string> vec;
+			vec.reserve(mSize);
+			for (std::string_view str : *this)
 			{
-				char dataType = this->at(i);
+				vec.emplace_back(str);
+			}
+			return vec;
+		}
+	};
 
-				switch (dataType)
-				{
-				case 'v':
-					if (message.size() - messageOffset < 1)
-					{
-						return false;
-					}
-					char byte = static_cast<char>(*(message.data() + messageOffset));
-					messageOffset += 1;
+	/* varintArrayView is a non-owning view over an array of compact integers ('Z', 'Q') as found in a received
+	 * message. Elements are decoded in order through its iterator, or all at once by copyTo and toVector
+	 */
+	template<typename T>
+	class varintArrayView
+	{
+	private:
+		const uint8_t* mBegin;
+		const uint8_t* mEnd;
+		size_t mSize;
 
-					switch (byte)
-					{
-					case 'd':
-					case 'D':
-					case 'i':
-					case 'I':
-					case 'u':
-					case 'U':
-					case 'w':
-					case 'W':
-					case 's':
-					case 'S':
-						dataType = byte;
-						break;
-					default:
-						spdlog::error("invalid signature {}", byte);
-						return false;
-					}
-					break;
-				}
+	public:
+		class iterator
+		{
+		private:
+			const uint8_t* mPos;
 
-				switch (dataType)
+		public:
+			explicit iterator(const uint8_t* pos) : mPos(pos)
+			{
+			}
+
+			T operator*() const
+			{
+				size_t offset = 0;
+				uint64_t val = 0;
+				decodeVarint(mPos, 10, offset, &val);
+				if constexpr (std::is_signed<T>::value) return zigzagDecode(val);
+				else return val;
+			}
+
+			iterator& operator++()
+			{
+				while (*mPos++ & 0x80)
 				{
-				case 'd':
-					{
-						if (message.size() - messageOffset < 8)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						double dblVal = bytesToDouble(message.data() + messageOffset, true);
-						messageOffset += 8;
+				}
+				return *this;
+			}
 
-						args[i] = dblVal;
-						break;
-					}
-				case 'D':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t arrSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+			bool operator==(const iterator& other) const { return mPos == other.mPos; }
+			bool operator!=(const iterator& other) const { return mPos != other.mPos; }
+		};
 
-						std::vector<double> dblArrVal(arrSize);
-						for (auto j = 0; j < dblArrVal.size(); j++)
-						{
-							if (message.size() - messageOffset < 8)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							dblArrVal[j] = bytesToDouble(message.data() + messageOffset, true);
-							messageOffset += 8;
-						}
+		varintArrayView() : mBegin(nullptr), mEnd(nullptr), mSize(0)
+		{
+		}
 
-						args[i] = dblArrVal;
-						break;
-					}
-				case 'i':
-					{
-						if (message.size() - messageOffset < 8)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						int64_t intVal = bytesToInt64(message.data() + messageOffset, true);
-						messageOffset += 8;
+		varintArrayView(const uint8_t* begin, const uint8_t* end, size_t size) : mBegin(begin), mEnd(end), mSize(size)
+		{
+		}
 
-						args[i] = intVal;
-						break;
-					}
-				case 'I':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t arrSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		iterator begin() const { return iterator(mBegin); }
+		iterator end() const { return iterator(mEnd); }
 
-						std::vector<int64_t> intArrVal(arrSize);
-						for (auto j = 0; j < intArrVal.size(); j++)
-						{
-							if (message.size() - messageOffset < 8)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							intArrVal[j] = bytesToInt64(message.data() + messageOffset, true);
-							messageOffset += 8;
-						}
+		void copyTo(T* dst) const
+		{
+			size_t offset = 0;
+			decodeVarintArray(mBegin, mEnd - mBegin, offset, mSize, dst);
+		}
 
-						args[i] = intArrVal;
-						break;
-					}
-				case 'u':
-					{
-						if (message.size() - messageOffset < 8)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint64_t uintVal = bytesToUint64(message.data() + messageOffset, true);
-						messageOffset += 8;
+		std::vector<T> toVector() const
+		{
+			std::vector<T> vec(mSize);
+			copyTo(vec.data());
+			return vec;
+		}
+	};
 
-						args[i] = uintVal;
-						break;
-					}
-				case 'U':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t arrSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+	// bitArrayView is a non-owning view over a bit packed array of bools ('B') as found in a received message
+	class bitArrayView
+	{
+	private:
+		const uint8_t* mData;
+		size_t mSize;
 
-						std::vector<uint64_t> uintArrVal(arrSize);
-						for (auto j = 0; j < uintArrVal.size(); j++)
-						{
-							if (message.size() - messageOffset < 8)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							uintArrVal[j] = bytesToUint64(message.data() + messageOffset, true);
-							messageOffset += 8;
-						}
+	public:
+		bitArrayView() : mData(nullptr), mSize(0)
+		{
+		}
 
-						args[i] = uintArrVal;
-						break;
-					}
-				case 'w':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t strSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+		bitArrayView(const uint8_t* data, size_t size) : mData(data), mSize(size)
+		{
+		}
 
-						if (message.size() - messageOffset < strSize)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						std::string byteVal(message.data() + messageOffset, message.data() + messageOffset + strSize);
-						std::wstring strVal(converter.from_bytes(byteVal.c_str()));
-						messageOffset += strSize;
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		const uint8_t* bytes() const { return mData; }
 
-						args[i] = strVal;
-						break;
-					}
-				case 'W':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t strArrSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+		bool operator[](size_t i) const
+		{
+			return (mData[i / 8] >> (i % 8)) & 1;
+		}
 
-						std::vector<std::wstring> strArr(strArrSize);
+		void copyTo(bool* dst) const
+		{
+			unpackBits(mData, mSize, dst);
+		}
 
-						for (int j = 0; j < strArrSize; j++)
-						{
-							if (message.size() - messageOffset < 2)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							uint16_t strSize = bytesToUint16(message.data() + messageOffset, true);
-							messageOffset += 2;
+		std::vector<bool> toVector() const
+		{
+			std::vector<bool> vec(mSize);
+			unpackBits(mData, mSize, vec.begin());
+			return vec;
+		}
+	};
 
-							if (message.size() - messageOffset < strSize)
+	/* variantView holds a decoded value as a view into the received message: strings ('s', 'w', 'l') as
+	 * std::string_view of their UTF-8 bytes, arrays as arrayView, varintArrayView, bitArrayView or stringArrayView,
+	 * binary blobs ('x') and arrays of uint8_t ('C') as byteView, arrays of tuples as recordArrayView. Views are valid
+	 * only as long as the message they were decoded from: when passed to a subscriber callback or to a procedure, until
+	 * the callback returns. A byteView can be put in a variant as is, to forward the blob without copying it
+	 */
+	typedef std::variant<int64_t, uint64_t, double, std::string_view, arrayView<int64_t>, arrayView<uint64_t>,
+	                     arrayView<double>, stringArrayView, arrayView<uint8_t>, varintArrayView<int64_t>,
+	                     varintArrayView<uint64_t>, recordArrayView, float, int32_t, int16_t, uint8_t, bool, arrayView<
+		                     float>, arrayView<int32_t>, arrayView<int16_t>, bitArrayView>
+	variantView;
+	typedef std::vector<variantView> variantViewVector;
+
+	// also reads the narrower integers a variant built from an int or a short holds, see heldInteger
+	inline bool getVariantValue(const variant& val, int64_t* pRetVal)
+	{
+		return heldInteger(val, pRetVal);
+	}
+
+	inline bool getVariantValue(const variant& val, uint64_t* pRetVal)
+	{
+		return heldInteger(val, pRetVal);
+	}
+
+	// also reads a float, as 'd' fields take it
+	inline bool getVariantValue(const variant& val, double* pRetVal)
+	{
+		if (const double* pDbl = std::get_if<double>(&val)) *pRetVal = *pDbl;
+		else if (const float* pFlt = std::get_if<float>(&val)) *pRetVal = *pFlt;
+		else return false;
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::wstring* pRetVal)
+	{
+		if (!std::holds_alternative<std::wstring>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::wstring>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::string* pRetVal)
+	{
+		if (!std::holds_alternative<std::string>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::string>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<int64_t>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<int64_t>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<int64_t>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<uint64_t>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<uint64_t>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<uint64_t>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<double>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<double>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<double>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<std::wstring>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<std::wstring>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<std::wstring>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<std::string>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<std::string>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<std::string>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<uint8_t>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<uint8_t>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<uint8_t>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, byteView* pRetVal)
+	{
+		if (!std::holds_alternative<byteView>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<byteView>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, float* pRetVal)
+	{
+		if (!std::holds_alternative<float>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<float>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, int32_t* pRetVal)
+	{
+		if (!std::holds_alternative<int32_t>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<int32_t>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, int16_t* pRetVal)
+	{
+		if (!std::holds_alternative<int16_t>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<int16_t>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, uint8_t* pRetVal)
+	{
+		if (!std::holds_alternative<uint8_t>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<uint8_t>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, bool* pRetVal)
+	{
+		if (!std::holds_alternative<bool>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<bool>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<float>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<float>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<float>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<int32_t>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<int32_t>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<int32_t>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<int16_t>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<int16_t>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<int16_t>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, std::vector<bool>* pRetVal)
+	{
+		if (!std::holds_alternative<std::vector<bool>>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<std::vector<bool>>(val);
+		return true;
+	}
+
+	inline bool getVariantValue(const variant& val, recordArray* pRetVal)
+	{
+		if (!std::holds_alternative<recordArray>(val))
+		{
+			return false;
+		}
+
+		*pRetVal = std::get<recordArray>(val);
+		return true;
+	}
+
+	/* getVariantPtr sets *ppRetVal to the T held by val, without copying it, e.g. for a 'S' argument:
+	 *     const std::vector<std::string>* pStrArr;
+	 *     if (!getVariantPtr(arguments[0], &pStrArr)) return false;
+	 * The pointer is valid as long as val is not modified. Returns false if val holds another type
+	 */
+	template<typename T>
+	inline bool getVariantPtr(const variant& val, const T** ppRetVal)
+	{
+		const T* pVal = std::get_if<T>(&val);
+		if (pVal == nullptr)
+		{
+			return false;
+		}
+
+		*ppRetVal = pVal;
+		return true;
+	}
+
+	// moves the T held by val to *pRetVal instead of copying it, e.g. getVariantValue(std::move(arguments[0]), &vec)
+	template<typename T>
+	inline bool getVariantValue(variant&& val, T* pRetVal)
+	{
+		T* pVal = std::get_if<T>(&val);
+		if (pVal == nullptr)
+		{
+			return false;
+		}
+
+		*pRetVal = std::move(*pVal);
+		return true;
+	}
+
+	/* dataSignature compiles its chars into a plan when constructed, so that encoding and decoding do not interpret
+	 * the signature per message. Consecutive fixed size numbers ('d', 'i', 'u', 'f', 'n', 'h', 'c', 'b') are merged
+	 * into a single block which is sized and bounds checked once, and whose fields are encoded and decoded by
+	 * functions selected at compile time. The chars cannot be changed afterwards, assign a new dataSignature instead.
+	 *
+	 * Fields can be grouped in tuples by '(' and ')', which only group: their fields are encoded one after the other
+	 * and are separate values in variantVector. Fields between '[' and ']' describe the records of an array of tuples,
+	 * which is a single recordArray value encoded as its 16 bit record count followed by the records, field after
+	 * field. Records can hold numbers and strings only. fieldCount() returns the number of values in variantVector
+	 */
+	class dataSignature
+	{
+	private:
+		// marks a plan step covering a run of fixed size fields
+		static constexpr char fixedRun = 0;
+
+		// field of a fixed run, with the functions of its data type
+		struct fixedField
+		{
+			uint32_t size;
+			bool (*holds)(const variant& val);
+			void (*encode)(const variant& val, uint8_t* message);
+			void (*decode)(const uint8_t* message, variant& val);
+			void (*decodeView)(const uint8_t* message, variantView& val);
+		};
+
+		struct planStep
+		{
+			char dataType;
+			uint32_t field;
+			// number of fields of a fixed run, or of the records of an array of tuples
+			uint32_t count;
+			// byte size of a fixed run
+			uint32_t size;
+			// offset of the record field types of an array of tuples in recordTypes, or of the fields of a fixed run
+			// in fixedFields
+			uint32_t types;
+		};
+
+		std::vector<char> mChars;
+		std::vector<planStep> plan;
+		// data type of every value, '[' for arrays of tuples
+		std::vector<char> fieldTypes;
+		// record field types of all arrays of tuples
+		std::string recordTypes;
+		std::vector<fixedField> fixedFields;
+
+		// the switches of holdsFixed, encodeFixed and decodeFixed are resolved here for a constant dataType
+		template<char dataType>
+		static fixedField makeFixedField()
+		{
+			return {
+				static_cast<uint32_t>(fixedSize(dataType)),
+				[](const variant& val) { return holdsFixed(dataType, val); },
+				[](const variant& val, uint8_t* message) { encodeFixed(dataType, val, message); },
+				[](const uint8_t* message, variant& val) { decodeFixed(dataType, message, val); },
+				[](const uint8_t* message, variantView& val) { decodeFixed(dataType, message, val); }
+			};
+		}
+
+		static fixedField getFixedField(char dataType)
+		{
+			switch (dataType)
+			{
+			case 'd':
+				return makeFixedField<'d'>();
+			case 'i':
+				return makeFixedField<'i'>();
+			case 'u':
+				return makeFixedField<'u'>();
+			case 'f':
+				return makeFixedField<'f'>();
+			case 'n':
+				return makeFixedField<'n'>();
+			case 'h':
+				return makeFixedField<'h'>();
+			case 'c':
+				return makeFixedField<'c'>();
+			default:
+				return makeFixedField<'b'>();
+			}
+		}
+
+		// appends to recordTypes the field types of the array of tuples starting at signature[begin], and sets *pEnd
+		// to its closing ']'. Returns false if the array of tuples is malformed or empty
+		bool compileRecord(const std::vector<char>& signature, size_t begin, size_t* pEnd)
+		{
+			size_t typesBegin = recordTypes.size();
+			int depth = 0;
+			for (size_t i = begin + 1; i < signature.size(); i++)
+			{
+				char dataType = signature[i];
+				if (dataType == '(')
+				{
+					depth++;
+				}
+				else if (dataType == ')')
+				{
+					if (--depth < 0) return false;
+				}
+				else if (dataType == ']')
+				{
+					*pEnd = i;
+					return depth == 0 && recordTypes.size() > typesBegin;
+				}
+				else if (isRecordFieldType(dataType))
+				{
+					recordTypes.push_back(dataType);
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return false;
+		}
+
+		void compile()
+		{
+			int depth = 0;
+			for (size_t i = 0; i < mChars.size() && depth >= 0; i++)
+			{
+				char dataType = mChars[i];
+				uint32_t field = fieldTypes.size();
+
+				if (dataType == '(' || dataType == ')')
+				{
+					depth += dataType == '(' ? 1 : -1;
+					continue;
+				}
+				if (dataType == '[')
+				{
+					uint32_t types = recordTypes.size();
+					if (!compileRecord(mChars, i, &i))
+					{
+						depth = -1;
+						break;
+					}
+					fieldTypes.push_back('[');
+					plan.push_back({'[', field, static_cast<uint32_t>(recordTypes.size() - types), 0, types});
+					continue;
+				}
+
+				fieldTypes.push_back(dataType);
+				uint32_t size = fixedSize(dataType);
+				if (size > 0)
+				{
+					fixedFields.push_back(getFixedField(dataType));
+					if (!plan.empty() && plan.back().dataType == fixedRun)
+					{
+						plan.back().count++;
+						plan.back().size += size;
+						continue;
+					}
+					plan.push_back({fixedRun, field, 1, size, static_cast<uint32_t>(fixedFields.size() - 1)});
+					continue;
+				}
+				plan.push_back({dataType, field, 1, 0, 0});
+			}
+
+			// a malformed signature compiles to a single step which fails encoding and decoding
+			if (depth != 0) plan.assign(1, {')', 0, 0, 0, 0});
+		}
+
+		template<typename T>
+		static uint8_t* encodeArray(const std::vector<T>& arr, bool wide, uint8_t* message)
+		{
+			message = writeLength(arr.size(), wide, message);
+			encodeArrayLE(arr.data(), arr.size(), message);
+			return message + arr.size() * sizeof(T);
+		}
+
+		static uint8_t* encodeString(const std::string& strVal, bool wide, uint8_t* message)
+		{
+			message = writeLength(strVal.size(), wide, message);
+			std::memcpy(message, strVal.data(), strVal.size());
+			return message + strVal.size();
+		}
+
+		// transcodes straight into the message, then writes the length prefix
+		static uint8_t* encodeWString(const std::wstring& wstrVal, bool wide, uint8_t* message)
+		{
+			uint8_t* end = encodeUtf8(wstrVal.data(), wstrVal.size(), message + lengthSize(wide));
+			writeLength(end - message - lengthSize(wide), wide, message);
+			return end;
+		}
+
+		// returns the T held by val, emplacing an empty one if val holds another type
+		template<typename T>
+		static T& reuseSlot(variant& val)
+		{
+			if (T* pVal = std::get_if<T>(&val)) return *pVal;
+			return val.emplace<T>();
+		}
+
+		/* resizes an array of strings to size, keeping the buffers of the strings it drops for the next arrays which
+		 * grow, in a spare list of the decoding thread. Arrays of varying length then settle at no allocation too
+		 */
+		template<typename S>
+		static void resizeStrings(std::vector<S>& arr, size_t size)
+		{
+			static thread_local std::vector<S> spare;
+			while (arr.size() > size)
+			{
+				spare.push_back(std::move(arr.back()));
+				arr.pop_back();
+			}
+			while (arr.size() < size && !spare.empty())
+			{
+				arr.push_back(std::move(spare.back()));
+				spare.pop_back();
+			}
+			arr.resize(size);
+		}
+
+		template<typename T>
+		static bool decodeArray(const uint8_t* message, size_t size, size_t& offset, bool wide, std::vector<T>& arr)
+		{
+			size_t arrSize;
+			if (!readLength(message, size, offset, wide, &arrSize)) return false;
+
+			if ((size - offset) / sizeof(T) < arrSize)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			arr.resize(arrSize);
+			decodeArrayLE(message + offset, arrSize, arr.data());
+			offset += arrSize * sizeof(T);
+			return true;
+		}
+
+		template<typename T>
+		static bool decodeVarintArray(const uint8_t* message, size_t size, size_t& offset, bool wide,
+		                              std::vector<T>& arr)
+		{
+			size_t arrSize;
+			if (!readLength(message, size, offset, wide, &arrSize)) return false;
+
+			// every element takes at least one byte, do not trust larger counts
+			if (size - offset < arrSize)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			arr.resize(arrSize);
+			if (!rpcmple::decodeVarintArray(message, size, offset, arrSize, arr.data()))
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			return true;
+		}
+
+		// tells whether a wide string may need more than 65535 bytes of UTF-8
+		static bool exceedsShortLength(const std::wstring& wstrVal)
+		{
+			return wstrVal.size() > 65535 / 4 && utf8Length(wstrVal) > 65535;
+		}
+
+		// tells whether the value of a 'v' field needs the wide type code, because it exceeds the 16 bit prefixes
+		static bool needsWide(const variant& val)
+		{
+			switch (variantDataType(val))
+			{
+			case 'w':
+				return exceedsShortLength(*std::get_if<std::wstring>(&val));
+			case 's':
+				return std::get_if<std::string>(&val)->size() > 65535;
+			case 'I':
+				return std::get_if<std::vector<int64_t>>(&val)->size() > 65535;
+			case 'U':
+				return std::get_if<std::vector<uint64_t>>(&val)->size() > 65535;
+			case 'D':
+				return std::get_if<std::vector<double>>(&val)->size() > 65535;
+			case 'W':
+				{
+					const auto& wstrArr = *std::get_if<std::vector<std::wstring>>(&val);
+					if (wstrArr.size() > 65535) return true;
+					for (const auto& wstrVal : wstrArr)
+					{
+						if (exceedsShortLength(wstrVal)) return true;
+					}
+					return false;
+				}
+			case 'S':
+				{
+					const auto& strArr = *std::get_if<std::vector<std::string>>(&val);
+					if (strArr.size() > 65535) return true;
+					for (const auto& strVal : strArr)
+					{
+						if (strVal.size() > 65535) return true;
+					}
+					return false;
+				}
+			case 'x':
+				return true;
+			default:
+				return false;
+			}
+		}
+
+	public:
+		dataSignature()
+		{
+		}
+
+		explicit dataSignature(std::vector<char> vec) : mChars(std::move(vec))
+		{
+			compile();
+		}
+
+		// the signature chars, also converted to when a dataSignature is passed where the chars are expected
+		const std::vector<char>& chars() const { return mChars; }
+
+		operator const std::vector<char>&() const { return mChars; }
+
+		size_t size() const { return mChars.size(); }
+
+		bool empty() const { return mChars.empty(); }
+
+		char operator[](size_t i) const { return mChars[i]; }
+
+		// number of values encoded by the signature, which is its size unless it has tuples or arrays of tuples
+		size_t fieldCount() const
+		{
+			return fieldTypes.size();
+		}
+
+		// data type of the field-th value, '[' for an array of tuples, 0 if out of range or the signature is malformed
+		char fieldType(size_t field) const
+		{
+			if (field >= fieldTypes.size() || (plan.size() == 1 && plan[0].dataType == ')')) return 0;
+			return fieldTypes[field];
+		}
+
+		// returns the signature char of the data held by a variant, as it would be declared in a signature
+		static char variantDataType(const variant& val)
+		{
+			static constexpr char dataTypes[] = {
+				'i', 'u', 'd', 'w', 's', 'I', 'U', 'D', 'W', 'S', 'x', '[', 'x', 'f', 'n', 'h', 'c', 'b', 'F', 'N', 'H', 'B'
+			};
+			static_assert(sizeof(dataTypes) == std::variant_size_v<variant>, "dataTypes must map every variant type");
+			return dataTypes[val.index()];
+		}
+
+		/* returns the type code a 'v' field sends val with. A variant built from an int or a short holds an int32_t
+		 * or an int16_t, which are sent as 'i', and a uint8_t as 'u', as peers not knowing the narrow types expect.
+		 * Narrow numbers are sent as such from 'n', 'h' and 'c' fields
+		 */
+		static char variantFieldType(const variant& val)
+		{
+			char dataType = variantDataType(val);
+			if (dataType == 'n' || dataType == 'h') return 'i';
+			if (dataType == 'c') return 'u';
+			return dataType;
+		}
+
+		// maps a wide type code ('l', 'L', 'J', 'K', 'E') to the base type code holding the same data, setting *pWide.
+		// 'x' has no base type code and is always wide
+		static constexpr char narrowDataType(char dataType, bool* pWide)
+		{
+			*pWide = true;
+			switch (dataType)
+			{
+			case 'l':
+				return 's';
+			case 'L':
+				return 'S';
+			case 'J':
+				return 'I';
+			case 'K':
+				return 'U';
+			case 'E':
+				return 'D';
+			case 'x':
+				return 'x';
+			default:
+				*pWide = false;
+				return dataType;
+			}
+		}
+
+		// returns signature with every 'i', 'u', 'I', 'U' replaced by its compact integer type code 'z', 'q', 'Z', 'Q'.
+		// Both sides must use the compact signature
+		static std::vector<char> compactIntegers(std::vector<char> signature)
+		{
+			for (char& dataType : signature)
+			{
+				switch (dataType)
+				{
+				case 'i':
+					dataType = 'z';
+					break;
+				case 'u':
+					dataType = 'q';
+					break;
+				case 'I':
+					dataType = 'Z';
+					break;
+				case 'U':
+					dataType = 'Q';
+					break;
+				}
+			}
+			return signature;
+		}
+
+		// maps a base type code to its wide type code
+		static constexpr char wideDataType(char dataType)
+		{
+			switch (dataType)
+			{
+			case 's':
+				return 'l';
+			case 'S':
+				return 'L';
+			case 'I':
+				return 'J';
+			case 'U':
+				return 'K';
+			case 'D':
+				return 'E';
+			default:
+				return dataType;
+			}
+		}
+
+		// computes the exact size of the binary encoding of rets, checking that values match the signature
+		bool encodedSize(const variantVector& rets, size_t* pSize) const
+		{
+			if (rets.size() < fieldCount())
+			{
+				spdlog::error("error converting variant, signature / values mismatch");
+				return false;
+			}
+
+			size_t messageSize = 0;
+
+			for (const planStep& step : plan)
+			{
+				if (step.dataType == fixedRun)
+				{
+					const fixedField* pFixed = fixedFields.data() + step.types;
+					for (uint32_t i = step.field; i < step.field + step.count; i++, pFixed++)
+					{
+						if (!pFixed->holds(rets[i]))
+						{
+							spdlog::error("error converting variant, signature / values mismatch");
+							return false;
+						}
+					}
+					messageSize += step.size;
+					continue;
+				}
+
+				char dataType = step.dataType;
+				const variant& val = rets[step.field];
+				bool wide;
+
+				if (dataType == 'v')
+				{
+					dataType = variantFieldType(val);
+					if (dataType == '[')
+					{
+						spdlog::error("an array of tuples cannot be sent as variant");
+						return false;
+					}
+					wide = needsWide(val);
+					messageSize += 1;
+				}
+				else
+				{
+					dataType = narrowDataType(dataType, &wide);
+				}
+
+				size_t lenSize = lengthSize(wide);
+				size_t maxLen = maxLength(wide);
+				size_t arrSize = 0;
+				bool success = true;
+
+				switch (dataType)
+				{
+				case 'd':
+				case 'i':
+				case 'u':
+				case 'f':
+				case 'n':
+				case 'h':
+				case 'c':
+				case 'b':
+					success = holdsFixed(dataType, val);
+					messageSize += fixedSize(dataType);
+					break;
+				case 'D':
+					success = std::holds_alternative<std::vector<double>>(val);
+					if (success) arrSize = std::get<std::vector<double>>(val).size();
+					messageSize += lenSize + arrSize * 8;
+					break;
+				case 'I':
+					success = std::holds_alternative<std::vector<int64_t>>(val);
+					if (success) arrSize = std::get<std::vector<int64_t>>(val).size();
+					messageSize += lenSize + arrSize * 8;
+					break;
+				case 'U':
+					success = std::holds_alternative<std::vector<uint64_t>>(val);
+					if (success) arrSize = std::get<std::vector<uint64_t>>(val).size();
+					messageSize += lenSize + arrSize * 8;
+					break;
+				case 'F':
+					success = std::holds_alternative<std::vector<float>>(val);
+					if (success) arrSize = std::get_if<std::vector<float>>(&val)->size();
+					messageSize += lenSize + arrSize * 4;
+					break;
+				case 'N':
+					success = std::holds_alternative<std::vector<int32_t>>(val);
+					if (success) arrSize = std::get_if<std::vector<int32_t>>(&val)->size();
+					messageSize += lenSize + arrSize * 4;
+					break;
+				case 'H':
+					success = std::holds_alternative<std::vector<int16_t>>(val);
+					if (success) arrSize = std::get_if<std::vector<int16_t>>(&val)->size();
+					messageSize += lenSize + arrSize * 2;
+					break;
+				case 'B':
+					success = std::holds_alternative<std::vector<bool>>(val);
+					if (success) arrSize = std::get_if<std::vector<bool>>(&val)->size();
+					messageSize += lenSize + (arrSize + 7) / 8;
+					break;
+				case 'C':
+				case 'x':
+					if (const auto* pBlob = std::get_if<std::vector<uint8_t>>(&val)) arrSize = pBlob->size();
+					else if (const auto* pBytes = std::get_if<byteView>(&val)) arrSize = pBytes->size();
+					else success = false;
+					messageSize += lenSize + arrSize;
+					break;
+				case 'z':
+					{
+						int64_t intVal;
+						success = heldInteger(val, &intVal);
+						if (success) messageSize += varintSize(zigzagEncode(intVal));
+						break;
+					}
+				case 'q':
+					{
+						uint64_t uintVal;
+						success = heldInteger(val, &uintVal);
+						if (success) messageSize += varintSize(uintVal);
+						break;
+					}
+				case 'Z':
+					{
+						success = std::holds_alternative<std::vector<int64_t>>(val);
+						if (!success) break;
+						const auto& intArr = *std::get_if<std::vector<int64_t>>(&val);
+						arrSize = intArr.size();
+						messageSize += lenSize;
+						for (int64_t intVal : intArr)
+						{
+							messageSize += varintSize(zigzagEncode(intVal));
+						}
+						break;
+					}
+				case 'Q':
+					{
+						success = std::holds_alternative<std::vector<uint64_t>>(val);
+						if (!success) break;
+						const auto& uintArr = *std::get_if<std::vector<uint64_t>>(&val);
+						arrSize = uintArr.size();
+						messageSize += lenSize;
+						for (uint64_t uintVal : uintArr)
+						{
+							messageSize += varintSize(uintVal);
+						}
+						break;
+					}
+				case 's':
+					{
+						success = std::holds_alternative<std::string>(val);
+						if (!success) break;
+						size_t strSize = std::get<std::string>(val).size();
+						if (strSize > maxLen)
+						{
+							spdlog::error("string size {} exceeding max allowed size {}", strSize, maxLen);
+							return false;
+						}
+						messageSize += lenSize + strSize;
+						break;
+					}
+				case 'S':
+					{
+						success = std::holds_alternative<std::vector<std::string>>(val);
+						if (!success) break;
+						const auto& strArr = std::get<std::vector<std::string>>(val);
+						arrSize = strArr.size();
+						messageSize += lenSize;
+						for (const auto& strVal : strArr)
+						{
+							if (strVal.size() > maxLen)
+							{
+								spdlog::error("string size {} exceeding max allowed size {}", strVal.size(), maxLen);
+								return false;
+							}
+							messageSize += lenSize + strVal.size();
+						}
+						break;
+					}
+				case 'w':
+					{
+						success = std::holds_alternative<std::wstring>(val);
+						if (!success) break;
+						size_t strSize = utf8Length(std::get<std::wstring>(val));
+						if (strSize > maxLen)
+						{
+							spdlog::error("string size {} exceeding max allowed size {}", strSize, maxLen);
+							return false;
+						}
+						messageSize += lenSize + strSize;
+						break;
+					}
+				case '[':
+					{
+						success = std::holds_alternative<recordArray>(val);
+						if (!success) break;
+						const auto& records = *std::get_if<recordArray>(&val);
+						if (records.fieldCount() != step.count)
+						{
+							spdlog::error("record size {} not matching signature record size {}", records.fieldCount(),
+							              step.count);
+							return false;
+						}
+						const char* types = recordTypes.data() + step.types;
+						arrSize = records.size();
+						messageSize += lenSize;
+						for (size_t j = 0; j < arrSize && success; j++)
+						{
+							const recordField* record = records[j];
+							for (uint32_t k = 0; k < step.count && success; k++)
+							{
+								success = recordFieldSize(types[k], record[k], &messageSize);
+							}
+						}
+						break;
+					}
+				case 'W':
+					{
+						success = std::holds_alternative<std::vector<std::wstring>>(val);
+						if (!success) break;
+						const auto& wstrArr = std::get<std::vector<std::wstring>>(val);
+						arrSize = wstrArr.size();
+						messageSize += lenSize;
+						for (const auto& wstrVal : wstrArr)
+						{
+							size_t strSize = utf8Length(wstrVal);
+							if (strSize > maxLen)
+							{
+								spdlog::error("string size {} exceeding max allowed size {}", strSize, maxLen);
+								return false;
+							}
+							messageSize += lenSize + strSize;
+						}
+						break;
+					}
+				default:
+					{
+						spdlog::error("invalid signature {}", dataType);
+						return false;
+					}
+				}
+
+				if (!success)
+				{
+					spdlog::error("error converting variant, signature / values mismatch");
+					return false;
+				}
+				if (arrSize > maxLen)
+				{
+					spdlog::error("array size {} exceeding max allowed size {}", arrSize, maxLen);
+					return false;
+				}
+			}
+
+			*pSize = messageSize;
+			return true;
+		}
+
+		// writes the binary encoding of rets to message, which must hold the size returned by encodedSize.
+		// Values are not checked against the signature, encodedSize must have succeeded on the same rets
+		uint8_t* encodeTo(const variantVector& rets, uint8_t* message)
+		{
+			for (const planStep& step : plan)
+			{
+				if (step.dataType == fixedRun)
+				{
+					const fixedField* pFixed = fixedFields.data() + step.types;
+					for (uint32_t i = step.field; i < step.field + step.count; i++, pFixed++)
+					{
+						pFixed->encode(rets[i], message);
+						message += pFixed->size;
+					}
+					continue;
+				}
+
+				char dataType = step.dataType;
+				const variant& val = rets[step.field];
+				bool wide;
+
+				if (dataType == 'v')
+				{
+					dataType = variantFieldType(val);
+					wide = needsWide(val);
+
+					char dataTypeW = dataType;
+					if (dataTypeW == 'w') dataTypeW = 's';
+					if (dataTypeW == 'W') dataTypeW = 'S';
+					if (wide) dataTypeW = wideDataType(dataTypeW);
+					*message++ = static_cast<uint8_t>(dataTypeW);
+				}
+				else
+				{
+					dataType = narrowDataType(dataType, &wide);
+				}
+
+				switch (dataType)
+				{
+				case 'd':
+				case 'i':
+				case 'u':
+				case 'f':
+				case 'n':
+				case 'h':
+				case 'c':
+				case 'b':
+					encodeFixed(dataType, val, message);
+					message += fixedSize(dataType);
+					break;
+				case 'F':
+					message = encodeArray(*std::get_if<std::vector<float>>(&val), wide, message);
+					break;
+				case 'N':
+					message = encodeArray(*std::get_if<std::vector<int32_t>>(&val), wide, message);
+					break;
+				case 'H':
+					message = encodeArray(*std::get_if<std::vector<int16_t>>(&val), wide, message);
+					break;
+				case 'B':
+					{
+						const auto& boolArr = *std::get_if<std::vector<bool>>(&val);
+						message = writeLength(boolArr.size(), wide, message);
+						packBits(boolArr.begin(), boolArr.size(), message);
+						message += (boolArr.size() + 7) / 8;
+						break;
+					}
+				case 'D':
+					message = encodeArray(*std::get_if<std::vector<double>>(&val), wide, message);
+					break;
+				case 'I':
+					message = encodeArray(*std::get_if<std::vector<int64_t>>(&val), wide, message);
+					break;
+				case 'U':
+					message = encodeArray(*std::get_if<std::vector<uint64_t>>(&val), wide, message);
+					break;
+				case 'C':
+				case 'x':
+					{
+						// a byteView is copied once, from the caller's memory straight into the message
+						const uint8_t* blobData;
+						size_t blobSize;
+						if (const auto* pBlob = std::get_if<std::vector<uint8_t>>(&val))
+						{
+							blobData = pBlob->data();
+							blobSize = pBlob->size();
+						}
+						else
+						{
+							blobData = std::get_if<byteView>(&val)->bytes();
+							blobSize = std::get_if<byteView>(&val)->size();
+						}
+						message = writeLength(blobSize, wide, message);
+						if (blobSize > 0) std::memcpy(message, blobData, blobSize);
+						message += blobSize;
+						break;
+					}
+				case 'z':
+					{
+						int64_t intVal = 0;
+						heldInteger(val, &intVal);
+						message = encodeVarint(zigzagEncode(intVal), message);
+						break;
+					}
+				case 'q':
+					{
+						uint64_t uintVal = 0;
+						heldInteger(val, &uintVal);
+						message = encodeVarint(uintVal, message);
+						break;
+					}
+				case 'Z':
+					{
+						const auto& intArr = *std::get_if<std::vector<int64_t>>(&val);
+						message = writeLength(intArr.size(), wide, message);
+						for (int64_t intVal : intArr)
+						{
+							message = encodeVarint(zigzagEncode(intVal), message);
+						}
+						break;
+					}
+				case 'Q':
+					{
+						const auto& uintArr = *std::get_if<std::vector<uint64_t>>(&val);
+						message = writeLength(uintArr.size(), wide, message);
+						for (uint64_t uintVal : uintArr)
+						{
+							message = encodeVarint(uintVal, message);
+						}
+						break;
+					}
+				case 's':
+					message = encodeString(*std::get_if<std::string>(&val), wide, message);
+					break;
+				case 'S':
+					{
+						const auto& strArr = *std::get_if<std::vector<std::string>>(&val);
+						message = writeLength(strArr.size(), wide, message);
+						for (const auto& strVal : strArr)
+						{
+							message = encodeString(strVal, wide, message);
+						}
+						break;
+					}
+				case 'w':
+					message = encodeWString(*std::get_if<std::wstring>(&val), wide, message);
+					break;
+				case 'W':
+					{
+						const auto& wstrArr = *std::get_if<std::vector<std::wstring>>(&val);
+						message = writeLength(wstrArr.size(), wide, message);
+						for (const auto& wstrVal : wstrArr)
+						{
+							message = encodeWString(wstrVal, wide, message);
+						}
+						break;
+					}
+				case '[':
+					{
+						const auto& records = *std::get_if<recordArray>(&val);
+						const char* types = recordTypes.data() + step.types;
+						message = writeLength(records.size(), wide, message);
+						for (size_t j = 0; j < records.size(); j++)
+						{
+							const recordField* record = records[j];
+							for (uint32_t k = 0; k < step.count; k++)
+							{
+								message = encodeRecordField(types[k], record[k], message);
+							}
+						}
+						break;
+					}
+				}
+			}
+			return message;
+		}
+
+		// encodes rets to message, after the first offset bytes which are left untouched.
+		// message is resized once to the exact encoded size
+		bool toBinary(const variantVector& rets, std::vector<uint8_t>& message, size_t offset = 0)
+		{
+			size_t messageSize;
+			if (!encodedSize(rets, &messageSize))
+			{
+				return false;
+			}
+
+			message.resize(offset + messageSize);
+			encodeTo(rets, message.data() + offset);
+			return true;
+		}
+
+		// decodes message to args as views into message, without copying strings and arrays. See variantView
+		bool fromBinaryView(const uint8_t* message, size_t size, variantViewVector& args) const
+		{
+			size_t messageOffset = 0;
+			args.resize(fieldCount());
+
+			for (const planStep& step : plan)
+			{
+				size_t i = step.field;
+				char dataType = step.dataType;
+
+				if (dataType == fixedRun)
+				{
+					if (size - messageOffset < step.size)
+					{
+						spdlog::error("cannot deserialize message: incomplete");
+						return false;
+					}
+					const fixedField* pFixed = fixedFields.data() + step.types;
+					for (; i < step.field + step.count; i++, pFixed++)
+					{
+						pFixed->decodeView(message + messageOffset, args[i]);
+						messageOffset += pFixed->size;
+					}
+					continue;
+				}
+
+				if (dataType == 'v')
+				{
+					if (size - messageOffset < 1)
+					{
+						spdlog::error("cannot deserialize message: incomplete");
+						return false;
+					}
+					dataType = static_cast<char>(message[messageOffset]);
+					messageOffset += 1;
+				}
+
+				bool wide;
+				dataType = narrowDataType(dataType, &wide);
+
+				switch (dataType)
+				{
+				case 'd':
+				case 'i':
+				case 'u':
+				case 'f':
+				case 'n':
+				case 'h':
+				case 'c':
+				case 'b':
+					{
+						if (size - messageOffset < fixedSize(dataType))
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						decodeFixed(dataType, message + messageOffset, args[i]);
+						messageOffset += fixedSize(dataType);
+						break;
+					}
+				case 'D':
+				case 'I':
+				case 'U':
+				case 'F':
+				case 'N':
+				case 'H':
+					{
+						size_t arrSize;
+						if (!readLength(message, size, messageOffset, wide, &arrSize)) return false;
+
+						// element size of an array is the size of its scalar type code
+						size_t elemSize = fixedSize(dataType - 'A' + 'a');
+						if ((size - messageOffset) / elemSize < arrSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						const uint8_t* arrBegin = message + messageOffset;
+						if (dataType == 'D') args[i] = arrayView<double>(arrBegin, arrSize);
+						else if (dataType == 'I') args[i] = arrayView<int64_t>(arrBegin, arrSize);
+						else if (dataType == 'U') args[i] = arrayView<uint64_t>(arrBegin, arrSize);
+						else if (dataType == 'F') args[i] = arrayView<float>(arrBegin, arrSize);
+						else if (dataType == 'N') args[i] = arrayView<int32_t>(arrBegin, arrSize);
+						else args[i] = arrayView<int16_t>(arrBegin, arrSize);
+						messageOffset += arrSize * elemSize;
+						break;
+					}
+				case 'B':
+					{
+						size_t arrSize;
+						if (!readLength(message, size, messageOffset, wide, &arrSize)) return false;
+
+						if (size - messageOffset < (arrSize + 7) / 8)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						args[i] = bitArrayView(message + messageOffset, arrSize);
+						messageOffset += (arrSize + 7) / 8;
+						break;
+					}
+				case 'C':
+				case 'x':
+					{
+						size_t blobSize;
+						if (!readLength(message, size, messageOffset, wide, &blobSize)) return false;
+
+						if (size - messageOffset < blobSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						args[i] = arrayView<uint8_t>(message + messageOffset, blobSize);
+						messageOffset += blobSize;
+						break;
+					}
+				case 'z':
+				case 'q':
+					{
+						uint64_t uintVal;
+						if (!decodeVarint(message, size, messageOffset, &uintVal))
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						if (dataType == 'z') args[i] = zigzagDecode(uintVal);
+						else args[i] = uintVal;
+						break;
+					}
+				case 'Z':
+				case 'Q':
+					{
+						size_t arrSize;
+						if (!readLength(message, size, messageOffset, wide, &arrSize)) return false;
+
+						size_t arrBegin = messageOffset;
+						for (size_t j = 0; j < arrSize; j++)
+						{
+							uint64_t uintVal;
+							if (!decodeVarint(message, size, messageOffset, &uintVal))
+							{
+								spdlog::error("cannot deserialize message: incomplete");
+								return false;
+							}
+						}
+						if (dataType == 'Z')
+						{
+							args[i] = varintArrayView<int64_t>(message + arrBegin, message + messageOffset, arrSize);
+						}
+						else
+						{
+							args[i] = varintArrayView<uint64_t>(message + arrBegin, message + messageOffset, arrSize);
+						}
+						break;
+					}
+				case 's':
+				case 'w':
+					{
+						size_t strSize;
+						if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+						if (size - messageOffset < strSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						args[i] = std::string_view(reinterpret_cast<const char*>(message + messageOffset), strSize);
+						messageOffset += strSize;
+						break;
+					}
+				case 'S':
+				case 'W':
+					{
+						size_t strArrSize;
+						if (!readLength(message, size, messageOffset, wide, &strArrSize)) return false;
+
+						size_t arrBegin = messageOffset;
+						for (size_t j = 0; j < strArrSize; j++)
+						{
+							size_t strSize;
+							if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+							if (size - messageOffset < strSize)
+							{
+								spdlog::error("cannot deserialize message: incomplete");
+								return false;
+							}
+							messageOffset += strSize;
+						}
+						args[i] = stringArrayView(message + arrBegin, message + messageOffset, strArrSize, wide);
+						break;
+					}
+				case '[':
+					{
+						// a variant type byte cannot select an array of tuples
+						if (step.dataType != '[')
+						{
+							spdlog::error("signature: invalid data type");
+							return false;
+						}
+						size_t recordCount;
+						if (!readLength(message, size, messageOffset, wide, &recordCount)) return false;
+
+						// every field takes at least one byte, do not trust larger counts
+						if ((size - messageOffset) / step.count < recordCount)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						const char* types = recordTypes.data() + step.types;
+						size_t arrBegin = messageOffset;
+						for (size_t j = 0; j < recordCount; j++)
+						{
+							for (uint32_t k = 0; k < step.count; k++)
+							{
+								if (!decodeRecordField(types[k], message, size, messageOffset, nullptr)) return false;
+							}
+						}
+						args[i] = recordArrayView(message + arrBegin, message + messageOffset, recordCount,
+						                          std::string_view(types, step.count));
+						break;
+					}
+				default:
+					{
+						spdlog::error("signature: invalid data type");
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		/* decodes message to args. Values are decoded in place into the strings and vectors args already holds at the
+		 * same position, reusing their capacity: decoding every message into the same args settles at no allocation.
+		 * A 'v' field is only reused while it keeps its type: a value of another type than the previous message
+		 * replaces the held one and allocates
+		 */
+		bool fromBinary(const uint8_t* message, size_t size, variantVector& args)
+		{
+			size_t messageOffset = 0;
+			args.resize(fieldCount());
+
+			for (const planStep& step : plan)
+			{
+				size_t i = step.field;
+				char dataType = step.dataType;
+
+				if (dataType == fixedRun)
+				{
+					if (size - messageOffset < step.size)
+					{
+						spdlog::error("cannot deserialize message: incomplete");
+						return false;
+					}
+					const fixedField* pFixed = fixedFields.data() + step.types;
+					for (; i < step.field + step.count; i++, pFixed++)
+					{
+						pFixed->decode(message + messageOffset, args[i]);
+						messageOffset += pFixed->size;
+					}
+					continue;
+				}
+
+				if (dataType == 'v')
+				{
+					if (size - messageOffset < 1)
+					{
+						return false;
+					}
+					char byte = static_cast<char>(message[messageOffset]);
+					messageOffset += 1;
+
+					switch (byte)
+					{
+					case 'd':
+					case 'D':
+					case 'E':
+					case 'i':
+					case 'I':
+					case 'J':
+					case 'u':
+					case 'U':
+					case 'K':
+					case 'w':
+					case 'W':
+					case 's':
+					case 'S':
+					case 'l':
+					case 'L':
+					case 'x':
+					case 'f':
+					case 'F':
+					case 'n':
+					case 'N':
+					case 'h':
+					case 'H':
+					case 'c':
+					case 'C':
+					case 'b':
+					case 'B':
+						dataType = byte;
+						break;
+					default:
+						spdlog::error("invalid signature {}", byte);
+						return false;
+					}
+				}
+
+				bool wide;
+				dataType = narrowDataType(dataType, &wide);
+
+				switch (dataType)
+				{
+				case 'd':
+				case 'i':
+				case 'u':
+				case 'f':
+				case 'n':
+				case 'h':
+				case 'c':
+				case 'b':
+					{
+						if (size - messageOffset < fixedSize(dataType))
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						decodeFixed(dataType, message + messageOffset, args[i]);
+						messageOffset += fixedSize(dataType);
+						break;
+					}
+				case 'D':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<double>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'I':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<int64_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'U':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<uint64_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'F':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<float>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'N':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<int32_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'H':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<int16_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'B':
+					{
+						size_t arrSize;
+						if (!readLength(message, size, messageOffset, wide, &arrSize)) return false;
+
+						if (size - messageOffset < (arrSize + 7) / 8)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						std::vector<bool>& boolArrVal = reuseSlot<std::vector<bool>>(args[i]);
+						boolArrVal.resize(arrSize);
+						unpackBits(message + messageOffset, arrSize, boolArrVal.begin());
+						messageOffset += (arrSize + 7) / 8;
+						break;
+					}
+				case 'C':
+				case 'x':
+					{
+						if (!decodeArray(message, size, messageOffset, wide, reuseSlot<std::vector<uint8_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'z':
+				case 'q':
+					{
+						uint64_t uintVal;
+						if (!decodeVarint(message, size, messageOffset, &uintVal))
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						if (dataType == 'z') args[i] = zigzagDecode(uintVal);
+						else args[i] = uintVal;
+						break;
+					}
+				case 'Z':
+					{
+						if (!decodeVarintArray(message, size, messageOffset, wide,
+						                       reuseSlot<std::vector<int64_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'Q':
+					{
+						if (!decodeVarintArray(message, size, messageOffset, wide,
+						                       reuseSlot<std::vector<uint64_t>>(args[i])))
+						{
+							return false;
+						}
+						break;
+					}
+				case 'w':
+					{
+						size_t strSize;
+						if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+						if (size - messageOffset < strSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						if (!decodeUtf8(message + messageOffset, strSize, reuseSlot<std::wstring>(args[i])))
+						{
+							spdlog::error("cannot deserialize message: invalid UTF-8 string");
+							return false;
+						}
+						messageOffset += strSize;
+						break;
+					}
+				case 'W':
+					{
+						size_t strArrSize;
+						if (!readLength(message, size, messageOffset, wide, &strArrSize)) return false;
+
+						// every string takes at least its length prefix, do not trust larger counts
+						if ((size - messageOffset) / lengthSize(wide) < strArrSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						std::vector<std::wstring>& strArr = reuseSlot<std::vector<std::wstring>>(args[i]);
+						resizeStrings(strArr, strArrSize);
+
+						for (size_t j = 0; j < strArrSize; j++)
+						{
+							size_t strSize;
+							if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+							if (size - messageOffset < strSize)
+							{
+								spdlog::error("cannot deserialize message: incomplete");
+								return false;
+							}
+							if (!decodeUtf8(message + messageOffset, strSize, strArr[j]))
+							{
+								spdlog::error("cannot deserialize message: invalid UTF-8 string");
+								return false;
+							}
+							messageOffset += strSize;
+						}
+						break;
+					}
+				case 's':
+					{
+						size_t strSize;
+						if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+						if (size - messageOffset < strSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						// assigning from char pointers, as byte iterators would go through a temporary string
+						reuseSlot<std::string>(args[i]).assign(reinterpret_cast<const char*>(message + messageOffset),
+						                                       strSize);
+						messageOffset += strSize;
+						break;
+					}
+				case 'S':
+					{
+						size_t strArrSize;
+						if (!readLength(message, size, messageOffset, wide, &strArrSize)) return false;
+
+						if ((size - messageOffset) / lengthSize(wide) < strArrSize)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						std::vector<std::string>& strArr = reuseSlot<std::vector<std::string>>(args[i]);
+						resizeStrings(strArr, strArrSize);
+
+						for (size_t j = 0; j < strArrSize; j++)
+						{
+							size_t strSize;
+							if (!readLength(message, size, messageOffset, wide, &strSize)) return false;
+
+							if (size - messageOffset < strSize)
 							{
 								spdlog::error("cannot deserialize message: incomplete");
 								return false;
 							}
-							std::string byteVal(message.data() + messageOffset,
-							                    message.data() + messageOffset + strSize);
-							strArr[j] = converter.from_bytes(byteVal.c_str());
+							strArr[j].assign(reinterpret_cast<const char*>(message + messageOffset), strSize);
 							messageOffset += strSize;
 						}
+						break;
+					}
+				case '[':
+					{
+						size_t recordCount;
+						if (!readLength(message, size, messageOffset, wide, &recordCount)) return false;
+
+						// every field takes at least one byte, do not trust larger counts
+						if ((size - messageOffset) / step.count < recordCount)
+						{
+							spdlog::error("cannot deserialize message: incomplete");
+							return false;
+						}
+						const char* types = recordTypes.data() + step.types;
+						recordArray& records = reuseSlot<recordArray>(args[i]);
+						if (records.fieldCount() != step.count) records = recordArray(step.count);
+						records.resize(recordCount);
+						for (size_t j = 0; j < recordCount; j++)
+						{
+							recordField* record = records[j];
+							for (uint32_t k = 0; k < step.count; k++)
+							{
+								if (!decodeRecordField(types[k], message, size, messageOffset, record + k))
+								{
+									return false;
+								}
+							}
+						}
+						break;
+					}
+
+				default:
+					{
+						spdlog::error("signature: invalid data type");
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		bool fromBinary(const std::vector<uint8_t>& message, variantVector& args)
+		{
+			return fromBinary(message.data(), message.size(), args);
+		}
+	};
+
+	/* typedCodec maps a c++ type to its signature char and to its binary encoding. It is specialized for every type
+	 * supported by dataSignature, so that typedSignature can select the whole encoder at compile time.
+	 * Produced bytes are identical to the ones of dataSignature::toBinary for the corresponding signature char
+	 */
+	template<typename T>
+	struct typedCodec;
+
+	template<typename T, char C, void (*toBytes)(T, uint8_t*, bool), T (*fromBytes)(const uint8_t*, bool)>
+	struct typedScalarCodec
+	{
+		static constexpr char code = C;
+
+		static bool encodedSize(const T&, size_t* pSize)
+		{
+			*pSize += 8;
+			return true;
+		}
+
+		static uint8_t* encode(const T& val, uint8_t* message)
+		{
+			toBytes(val, message, true);
+			return message + 8;
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, T& val)
+		{
+			if (size - offset < 8)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			val = fromBytes(message + offset, true);
+			offset += 8;
+			return true;
+		}
+	};
+
+	template<>
+	struct typedCodec<int64_t> : typedScalarCodec<int64_t, 'i', int64ToBytes, bytesToInt64>
+	{
+	};
+
+	template<>
+	struct typedCodec<uint64_t> : typedScalarCodec<uint64_t, 'u', uint64ToBytes, bytesToUint64>
+	{
+	};
+
+	template<>
+	struct typedCodec<double> : typedScalarCodec<double, 'd', doubleToBytes, bytesToDouble>
+	{
+	};
+
+	// narrow numbers are encoded little endian in their own size, bool as a 0 or 1 byte
+	template<typename T, char C>
+	struct typedNarrowCodec
+	{
+		static constexpr char code = C;
+
+		static bool encodedSize(const T&, size_t* pSize)
+		{
+			*pSize += sizeof(T);
+			return true;
+		}
+
+		static uint8_t* encode(const T& val, uint8_t* message)
+		{
+			if constexpr (std::is_same<T, bool>::value) *message = val ? 1 : 0;
+			else encodeArrayLE(&val, 1, message);
+			return message + sizeof(T);
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, T& val)
+		{
+			if (size - offset < sizeof(T))
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			if constexpr (std::is_same<T, bool>::value) val = message[offset] != 0;
+			else decodeArrayLE(message + offset, 1, &val);
+			offset += sizeof(T);
+			return true;
+		}
+	};
+
+	template<>
+	struct typedCodec<float> : typedNarrowCodec<float, 'f'>
+	{
+	};
+
+	template<>
+	struct typedCodec<int32_t> : typedNarrowCodec<int32_t, 'n'>
+	{
+	};
+
+	template<>
+	struct typedCodec<int16_t> : typedNarrowCodec<int16_t, 'h'>
+	{
+	};
+
+	template<>
+	struct typedCodec<uint8_t> : typedNarrowCodec<uint8_t, 'c'>
+	{
+	};
+
+	template<>
+	struct typedCodec<bool> : typedNarrowCodec<bool, 'b'>
+	{
+	};
+
+	/* strings are encoded as their byte count, 16 bit or 32 bit when wide, followed by the UTF-8 bytes.
+	 * std::string_view decodes as a view into the message
+	 */
+	template<typename S, char C, bool wide>
+	struct typedStringCodec
+	{
+		static constexpr char code = C;
+
+		static bool encodedSize(const S& val, size_t* pSize)
+		{
+			if (val.size() > maxLength(wide))
+			{
+				spdlog::error("string size {} exceeding max allowed size {}", val.size(), maxLength(wide));
+				return false;
+			}
+			*pSize += lengthSize(wide) + val.size();
+			return true;
+		}
+
+		static uint8_t* encode(const S& val, uint8_t* message)
+		{
+			message = writeLength(val.size(), wide, message);
+			std::memcpy(message, val.data(), val.size());
+			return message + val.size();
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, S& val)
+		{
+			size_t strSize;
+			if (!readLength(message, size, offset, wide, &strSize)) return false;
+
+			if (size - offset < strSize)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			if constexpr (std::is_same<S, std::string_view>::value)
+			{
+				val = std::string_view(reinterpret_cast<const char*>(message + offset), strSize);
+			}
+			else
+			{
+				val.assign(reinterpret_cast<const char*>(message) + offset, strSize);
+			}
+			offset += strSize;
+			return true;
+		}
+	};
+
+	template<>
+	struct typedCodec<std::string> : typedStringCodec<std::string, 's', false>
+	{
+	};
+
+	// std::string_view encodes as 's' without copying to std::string, and decodes as a view into the message
+	template<>
+	struct typedCodec<std::string_view> : typedStringCodec<std::string_view, 's', false>
+	{
+	};
+
+	// longString is a std::string encoded with a 32 bit length prefix, as 'l'
+	struct longString : std::string
+	{
+		using std::string::basic_string;
+
+		longString(const std::string& str) : std::string(str)
+		{
+		}
+
+		longString(std::string&& str) : std::string(std::move(str))
+		{
+		}
+	};
+
+	template<>
+	struct typedCodec<longString> : typedStringCodec<longString, 'l', true>
+	{
+	};
+
+	template<>
+	struct typedCodec<std::wstring>
+	{
+		static constexpr char code = 'w';
+
+		static bool encodedSize(const std::wstring& val, size_t* pSize)
+		{
+			size_t strSize = utf8Length(val);
+			if (strSize > 65535)
+			{
+				spdlog::error("string size {} exceeding max allowed size 65535", strSize);
+				return false;
+			}
+			*pSize += 2 + strSize;
+			return true;
+		}
+
+		static uint8_t* encode(const std::wstring& val, uint8_t* message)
+		{
+			uint8_t* end = encodeUtf8(val.data(), val.size(), message + 2);
+			uint16ToBytes(end - message - 2, message, true);
+			return end;
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, std::wstring& val)
+		{
+			if (size - offset < 2)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			uint16_t strSize = bytesToUint16(message + offset, true);
+			offset += 2;
 
-						args[i] = strArr;
-						break;
-					}
-				case 's':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t strSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+			if (size - offset < strSize)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			if (!decodeUtf8(message + offset, strSize, val))
+			{
+				spdlog::error("cannot deserialize message: invalid UTF-8 string");
+				return false;
+			}
+			offset += strSize;
+			return true;
+		}
+	};
 
-						if (message.size() - messageOffset < strSize)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						std::string byteVal(message.data() + messageOffset, message.data() + messageOffset + strSize);
-						messageOffset += strSize;
+	// arrayView encodes as the array of its element type, and decodes as a view into the message
+	template<typename T>
+	struct typedCodec<arrayView<T>>
+	{
+		static constexpr char code = typedCodec<T>::code - 'a' + 'A';
 
-						args[i] = byteVal;
-						break;
-					}
-				case 'S':
-					{
-						if (message.size() - messageOffset < 2)
-						{
-							spdlog::error("cannot deserialize message: incomplete");
-							return false;
-						}
-						uint16_t strArrSize = bytesToUint16(message.data() + messageOffset, true);
-						messageOffset += 2;
+		static bool encodedSize(const arrayView<T>& val, size_t* pSize)
+		{
+			if (val.size() > 65535)
+			{
+				spdlog::error("array size {} exceeding max allowed size 65535", val.size());
+				return false;
+			}
+			*pSize += 2 + val.size() * sizeof(T);
+			return true;
+		}
 
-						std::vector<std::string> strArr(strArrSize);
+		static uint8_t* encode(const arrayView<T>& val, uint8_t* message)
+		{
+			uint16ToBytes(val.size(), message, true);
+			message += 2;
+			if (!val.empty()) std::memcpy(message, val.bytes(), val.size() * sizeof(T));
+			return message + val.size() * sizeof(T);
+		}
 
-						for (int j = 0; j < strArrSize; j++)
-						{
-							if (message.size() - messageOffset < 2)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							uint16_t strSize = bytesToUint16(message.data() + messageOffset, true);
-							messageOffset += 2;
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, arrayView<T>& val)
+		{
+			if (size - offset < 2)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			uint16_t arrSize = bytesToUint16(message + offset, true);
+			offset += 2;
 
-							if (message.size() - messageOffset < strSize)
-							{
-								spdlog::error("cannot deserialize message: incomplete");
-								return false;
-							}
-							std::string byteVal(message.data() + messageOffset,
-							                    message.data() + messageOffset + strSize);
-							strArr[j] = byteVal;
-							messageOffset += strSize;
-						}
+			if (size - offset < arrSize * sizeof(T))
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			val = arrayView<T>(message + offset, arrSize);
+			offset += arrSize * sizeof(T);
+			return true;
+		}
+	};
 
-						args[i] = strArr;
-						break;
-					}
+	/* arrays are encoded as their element count, 16 bit or 32 bit when wide, followed by the elements. Elements are
+	 * encoded by ElementCodec, numbers in bulk
+	 */
+	template<typename V, typename ElementCodec, char C, bool wide>
+	struct typedArrayCodec
+	{
+		typedef typename V::value_type T;
+		static constexpr char code = C;
 
-				default:
-					{
-						spdlog::error("signature: invalid data type");
-						return false;
-					}
+		static bool encodedSize(const V& val, size_t* pSize)
+		{
+			if (val.size() > maxLength(wide))
+			{
+				spdlog::error("array size {} exceeding max allowed size {}", val.size(), maxLength(wide));
+				return false;
+			}
+			*pSize += lengthSize(wide);
+			if constexpr (std::is_arithmetic<T>::value)
+			{
+				*pSize += val.size() * sizeof(T);
+			}
+			else
+			{
+				for (const T& element : val)
+				{
+					if (!ElementCodec::encodedSize(element, pSize)) return false;
+				}
+			}
+			return true;
+		}
+
+		static uint8_t* encode(const V& val, uint8_t* message)
+		{
+			message = writeLength(val.size(), wide, message);
+			if constexpr (std::is_arithmetic<T>::value)
+			{
+				encodeArrayLE(val.data(), val.size(), message);
+				return message + val.size() * sizeof(T);
+			}
+			else
+			{
+				for (const T& element : val)
+				{
+					message = ElementCodec::encode(element, message);
+				}
+				return message;
+			}
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, V& val)
+		{
+			size_t arrSize;
+			if (!readLength(message, size, offset, wide, &arrSize)) return false;
+
+			if constexpr (std::is_arithmetic<T>::value)
+			{
+				if ((size - offset) / sizeof(T) < arrSize)
+				{
+					spdlog::error("cannot deserialize message: incomplete");
+					return false;
+				}
+				val.resize(arrSize);
+				decodeArrayLE(message + offset, arrSize, val.data());
+				offset += arrSize * sizeof(T);
+			}
+			else
+			{
+				// every element takes at least its length prefix, do not trust larger counts
+				if ((size - offset) / lengthSize(wide) < arrSize)
+				{
+					spdlog::error("cannot deserialize message: incomplete");
+					return false;
+				}
+				val.resize(arrSize);
+				for (T& element : val)
+				{
+					if (!ElementCodec::decode(message, size, offset, element)) return false;
 				}
 			}
 			return true;
 		}
 	};
+
+	// byteView encodes as a binary blob 'x' without going through std::vector<uint8_t>, and decodes as a view into the
+	// message
+	template<>
+	struct typedCodec<byteView>
+	{
+		static constexpr char code = 'x';
+
+		static bool encodedSize(const byteView& val, size_t* pSize)
+		{
+			if (val.size() > maxLength(true))
+			{
+				spdlog::error("blob size {} exceeding max allowed size {}", val.size(), maxLength(true));
+				return false;
+			}
+			*pSize += lengthSize(true) + val.size();
+			return true;
+		}
+
+		static uint8_t* encode(const byteView& val, uint8_t* message)
+		{
+			message = writeLength(val.size(), true, message);
+			if (!val.empty()) std::memcpy(message, val.bytes(), val.size());
+			return message + val.size();
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, byteView& val)
+		{
+			size_t blobSize;
+			if (!readLength(message, size, offset, true, &blobSize)) return false;
+
+			if (size - offset < blobSize)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			val = byteView(message + offset, blobSize);
+			offset += blobSize;
+			return true;
+		}
+	};
+
+	// arrays of 16 bit count, upper case char of the element type
+	template<typename T>
+	struct typedCodec<std::vector<T>> : typedArrayCodec<std::vector<T>, typedCodec<T>, typedCodec<T>::code - 'a' + 'A',
+	                                                    false>
+	{
+		static_assert(typedCodec<T>::code >= 'a' && typedCodec<T>::code <= 'z', "unsupported array element type");
+	};
+
+	// binary blobs are encoded as 'x', 32 bit byte count followed by the bytes
+	template<>
+	struct typedCodec<std::vector<uint8_t>> : typedArrayCodec<std::vector<uint8_t>, void, 'x', true>
+	{
+	};
+
+	// arrays of bools are encoded as 'B', 16 bit count followed by the bit packed bools
+	template<>
+	struct typedCodec<std::vector<bool>>
+	{
+		static constexpr char code = 'B';
+
+		static bool encodedSize(const std::vector<bool>& val, size_t* pSize)
+		{
+			if (val.size() > 65535)
+			{
+				spdlog::error("array size {} exceeding max allowed size 65535", val.size());
+				return false;
+			}
+			*pSize += 2 + (val.size() + 7) / 8;
+			return true;
+		}
+
+		static uint8_t* encode(const std::vector<bool>& val, uint8_t* message)
+		{
+			message = writeLength(val.size(), false, message);
+			packBits(val.begin(), val.size(), message);
+			return message + (val.size() + 7) / 8;
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, std::vector<bool>& val)
+		{
+			size_t arrSize;
+			if (!readLength(message, size, offset, false, &arrSize)) return false;
+
+			if (size - offset < (arrSize + 7) / 8)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			val.resize(arrSize);
+			unpackBits(message + offset, arrSize, val.begin());
+			offset += (arrSize + 7) / 8;
+			return true;
+		}
+	};
+
+	/* longVector is a std::vector encoded with a 32 bit element count, as 'J', 'K', 'E' for numbers and 'L' for
+	 * strings, whose elements then also have 32 bit length prefixes
+	 */
+	template<typename T>
+	struct longVector : std::vector<T>
+	{
+		using std::vector<T>::vector;
+
+		longVector(const std::vector<T>& vec) : std::vector<T>(vec)
+		{
+		}
+
+		longVector(std::vector<T>&& vec) : std::vector<T>(std::move(vec))
+		{
+		}
+	};
+
+	template<typename T>
+	struct typedCodec<longVector<T>> : typedArrayCodec<longVector<T>, typedCodec<T>, dataSignature::wideDataType(
+		                                                   typedCodec<T>::code - 'a' + 'A'), true>
+	{
+		static_assert(std::is_arithmetic<T>::value, "unsupported long array element type");
+	};
+
+	template<>
+	struct typedCodec<longVector<std::string>> : typedArrayCodec<longVector<std::string>, typedStringCodec<
+		                                                             std::string, 'l', true>, 'L', true>
+	{
+	};
+
+	// typedChars appends the signature chars of a type, which are more than one for tuples and arrays of tuples
+	template<typename T>
+	struct typedChars
+	{
+		static void append(std::vector<char>& chars)
+		{
+			chars.push_back(typedCodec<T>::code);
+		}
+	};
+
+	// std::tuple is encoded as its elements one after the other, its signature chars are enclosed by '(' and ')'
+	template<typename... Ts>
+	struct typedCodec<std::tuple<Ts...>>
+	{
+		static bool encodedSize(const std::tuple<Ts...>& val, size_t* pSize)
+		{
+			return std::apply([pSize](const Ts&... elements)
+			{
+				return (typedCodec<Ts>::encodedSize(elements, pSize) && ...);
+			}, val);
+		}
+
+		static uint8_t* encode(const std::tuple<Ts...>& val, uint8_t* message)
+		{
+			std::apply([&message](const Ts&... elements)
+			{
+				((message = typedCodec<Ts>::encode(elements, message)), ...);
+			}, val);
+			return message;
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, std::tuple<Ts...>& val)
+		{
+			return std::apply([&](Ts&... elements)
+			{
+				return (typedCodec<Ts>::decode(message, size, offset, elements) && ...);
+			}, val);
+		}
+	};
+
+	template<typename... Ts>
+	struct typedChars<std::tuple<Ts...>>
+	{
+		static void append(std::vector<char>& chars)
+		{
+			chars.push_back('(');
+			(typedChars<Ts>::append(chars), ...);
+			chars.push_back(')');
+		}
+	};
+
+	// tells whether a type can be a field of the records of an array of tuples
+	template<typename T>
+	struct isTypedRecordField : std::bool_constant<isRecordFieldType(typedCodec<T>::code)>
+	{
+	};
+
+	template<typename... Ts>
+	struct isTypedRecordField<std::tuple<Ts...>> : std::bool_constant<(isTypedRecordField<Ts>::value && ...)>
+	{
+	};
+
+	/* std::vector of std::tuple is an array of tuples, encoded as its 16 bit record count followed by the records.
+	 * Its signature chars are enclosed by '[' and ']', and decoded records are stored contiguously in the vector
+	 */
+	template<typename... Ts>
+	struct typedCodec<std::vector<std::tuple<Ts...>>>
+	{
+		static_assert(sizeof...(Ts) > 0 && (isTypedRecordField<Ts>::value && ...), "unsupported record field type");
+
+		typedef typedCodec<std::tuple<Ts...>> recordCodec;
+
+		static bool encodedSize(const std::vector<std::tuple<Ts...>>& val, size_t* pSize)
+		{
+			if (val.size() > 65535)
+			{
+				spdlog::error("array size {} exceeding max allowed size 65535", val.size());
+				return false;
+			}
+			*pSize += 2;
+			for (const auto& record : val)
+			{
+				if (!recordCodec::encodedSize(record, pSize)) return false;
+			}
+			return true;
+		}
+
+		static uint8_t* encode(const std::vector<std::tuple<Ts...>>& val, uint8_t* message)
+		{
+			message = writeLength(val.size(), false, message);
+			for (const auto& record : val)
+			{
+				message = recordCodec::encode(record, message);
+			}
+			return message;
+		}
+
+		static bool decode(const uint8_t* message, size_t size, size_t& offset, std::vector<std::tuple<Ts...>>& val)
+		{
+			size_t recordCount;
+			if (!readLength(message, size, offset, false, &recordCount)) return false;
+
+			// every field takes at least one byte, do not trust larger counts
+			if ((size - offset) / sizeof...(Ts) < recordCount)
+			{
+				spdlog::error("cannot deserialize message: incomplete");
+				return false;
+			}
+			val.resize(recordCount);
+			for (auto& record : val)
+			{
+				if (!recordCodec::decode(message, size, offset, record)) return false;
+			}
+			return true;
+		}
+	};
+
+	template<typename... Ts>
+	struct typedChars<std::vector<std::tuple<Ts...>>>
+	{
+		static void append(std::vector<char>& chars)
+		{
+			chars.push_back('[');
+			(typedChars<Ts>::append(chars), ...);
+			chars.push_back(']');
+		}
+	};
+
+	/* typedSignature is the compile time counterpart of dataSignature. Data is passed as std::tuple of supported types
+	 * (int64_t, uint64_t, double, float, int32_t, int16_t, uint8_t, bool, std::string, std::wstring and std::vector of
+	 * those, longString, longVector, std::vector<uint8_t> or byteView blobs, std::tuple of those and std::vector of
+	 * std::tuple of numbers and strings) and encoded / decoded without going through rpcmple::variant. Binary format is
+	 * the same as dataSignature with signature returned by chars(), so a typedSignature on one side can talk to a
+	 * dataSignature on the other side.
+	 */
+	template<typename... Ts>
+	class typedSignature
+	{
+	private:
+		template<std::size_t... Is>
+		static bool encodedSizeAll(const std::tuple<Ts...>& values, size_t* pSize, std::index_sequence<Is...>)
+		{
+			return (typedCodec<Ts>::encodedSize(std::get<Is>(values), pSize) && ...);
+		}
+
+		template<std::size_t... Is>
+		static uint8_t* encodeAll(const std::tuple<Ts...>& values, uint8_t* message, std::index_sequence<Is...>)
+		{
+			((message = typedCodec<Ts>::encode(std::get<Is>(values), message)), ...);
+			return message;
+		}
+
+		template<std::size_t... Is>
+		static bool decodeAll(const uint8_t* message, size_t size, size_t& offset, std::tuple<Ts...>& values,
+		                      std::index_sequence<Is...>)
+		{
+			return (typedCodec<Ts>::decode(message, size, offset, std::get<Is>(values)) && ...);
+		}
+
+	public:
+		typedef std::tuple<Ts...> tuple;
+
+		static const std::vector<char>& chars()
+		{
+			static const std::vector<char> signature = []
+			{
+				std::vector<char> chars;
+				(typedChars<Ts>::append(chars), ...);
+				return chars;
+			}();
+			return signature;
+		}
+
+		static bool matches(const std::vector<char>& signature)
+		{
+			return signature == chars();
+		}
+
+		static bool encodedSize(const tuple& values, size_t* pSize)
+		{
+			*pSize = 0;
+			return encodedSizeAll(values, pSize, std::index_sequence_for<Ts...>{});
+		}
+
+		static uint8_t* encodeTo(const tuple& values, uint8_t* message)
+		{
+			return encodeAll(values, message, std::index_sequence_for<Ts...>{});
+		}
+
+		static bool toBinary(const tuple& values, std::vector<uint8_t>& message, size_t offset = 0)
+		{
+			size_t messageSize;
+			if (!encodedSize(values, &messageSize))
+			{
+				return false;
+			}
+
+			message.resize(offset + messageSize);
+			encodeTo(values, message.data() + offset);
+			return true;
+		}
+
+		static bool fromBinary(const uint8_t* message, size_t size, tuple& values)
+		{
+			size_t offset = 0;
+			return decodeAll(message, size, offset, values, std::index_sequence_for<Ts...>{});
+		}
+
+		static bool fromBinary(const std::vector<uint8_t>& message, tuple& values)
+		{
+			return fromBinary(message.data(), message.size(), values);
+		}
+	};
 }
 
 
@@ -8,9 +8,12 @@
 
 #include "messageManager.h"
 #include "dataSignature.h"
+#include "seriesCodec.h"
+#include "columnBatch.h"
 #include "rpcmple.h"
 
 #include <functional>
+#include <memory>
 
 namespace rpcmple
 {
@@ -18,48 +21,175 @@ namespace rpcmple
 	{
 	private:
 		dataSignature mSignature;
-		std::function<void(rpcmple::variantVector)> callbackFunction;
+		std::function<void(rpcmple::variantVector&)> callbackFunction;
+		// decoded values are kept across messages, so that their strings and arrays are reused
+		rpcmple::variantVector args;
+		std::function<bool(const uint8_t*, size_t)> typedDecoder;
+		std::function<void(const rpcmple::variantViewVector&)> viewCallbackFunction;
+		rpcmple::variantViewVector viewArgs;
+		std::function<void(const rpcmple::columnBatch&)> batchCallbackFunction;
+		rpcmple::columnBatch batch;
+		// signature of the columns of a batch, set on the first batch received
+		dataSignature mColumnSignature;
+		rpcmple::variantVector batchColumns;
+
+		// created on the first compressed frame received, see dataPublisher::enableSeriesCompression
+		std::unique_ptr<seriesCodec> series;
+		std::vector<uint8_t> seriesRecord;
 
 
 		uint32_t sectionLen;
 		uint16_t sectionID;
+		uint32_t sectionFlag;
+
+		/* delivers a batch frame to the batch callback, or record by record to the variantVector callback. With a
+		 * batch callback, records published one by one are delivered as batches of one record
+		 */
+		bool parseBatch(const uint8_t* message, size_t size, bool isBatch)
+		{
+			if (mColumnSignature.empty() && !columnBatch::columnSignature(mSignature, mColumnSignature))
+			{
+				spdlog::error("dataSubscriber: batch received for a signature which cannot be batched");
+				return false;
+			}
+
+			if (batchCallbackFunction)
+			{
+				std::vector<uint8_t> batchMessage;
+				if (!isBatch)
+				{
+					std::vector<variantVector> records(1);
+					variantVector columns;
+					if (!mSignature.fromBinary(message, size, records[0]) ||
+						!columnBatch::toColumns(mSignature, records, 0, 1, columns) ||
+						!mColumnSignature.toBinary(columns, batchMessage))
+					{
+						spdlog::error("dataSubscriber: error in RPC message parsing: invalid message");
+						return false;
+					}
+					message = batchMessage.data();
+					size = batchMessage.size();
+				}
+				if (!batch.decode(mColumnSignature, message, size))
+				{
+					spdlog::error("dataSubscriber: error in RPC message parsing: invalid batch");
+					return false;
+				}
+				batchCallbackFunction(batch);
+				return true;
+			}
+
+			if (typedDecoder || viewCallbackFunction)
+			{
+				spdlog::error("dataSubscriber: batches require a batch or a variantVector callback");
+				return false;
+			}
+
+			variantVector& columns = batchColumns;
+			if (!mColumnSignature.fromBinary(message, size, columns) || columns.size() != mColumnSignature.size())
+			{
+				spdlog::error("dataSubscriber: error in RPC message parsing: invalid batch");
+				return false;
+			}
+			size_t rows = columnBatch::columnSize(columns[0]);
+			for (const variant& column : columns)
+			{
+				if (columnBatch::columnSize(column) != rows)
+				{
+					spdlog::error("dataSubscriber: error in RPC message parsing: invalid batch");
+					return false;
+				}
+			}
+
+			for (size_t row = 0; row < rows; row++)
+			{
+				columnBatch::toRecord(columns, row, args);
+				if (callbackFunction) callbackFunction(args);
+			}
+			return true;
+		}
 
 	public:
+		/* callback receives values decoded into storage which is reused by the next message. It can take the
+		 * variantVector by value, or by reference to avoid copying it
+		 */
 		dataSubscriber(rpcmple::connectionManager::base* pConn, std::vector<char> signature,
-		               std::function<void(rpcmple::variantVector)> callback)
+		               std::function<void(rpcmple::variantVector&)> callback)
 			: messageManager(pConn, true), mSignature(std::move(signature)), callbackFunction(std::move(callback)),
 			  sectionLen(4),
-			  sectionID(0)
+			  sectionID(0), sectionFlag(1)
 		{
 		}
 
+		// callback receives values as views into the received message, valid until the callback returns
+		dataSubscriber(rpcmple::connectionManager::base* pConn, std::vector<char> signature,
+		               std::function<void(const rpcmple::variantViewVector&)> callback)
+			: messageManager(pConn, true), mSignature(std::move(signature)),
+			  viewCallbackFunction(std::move(callback)), sectionLen(4), sectionID(0), sectionFlag(1)
+		{
+		}
+
+		// callback receives batches published by dataPublisher::publishBatch, see columnBatch
+		dataSubscriber(rpcmple::connectionManager::base* pConn, std::vector<char> signature,
+		               std::function<void(const rpcmple::columnBatch&)> callback)
+			: messageManager(pConn, true), mSignature(std::move(signature)),
+			  batchCallbackFunction(std::move(callback)), sectionLen(4), sectionID(0), sectionFlag(1)
+		{
+		}
+
+		template<typename... Ts>
+		dataSubscriber(rpcmple::connectionManager::base* pConn, typedSignature<Ts...> signature,
+		               std::function<void(typename typedSignature<Ts...>::tuple&)> callback)
+			: messageManager(pConn, true), mSignature(signature.chars()), sectionLen(4), sectionID(0), sectionFlag(1)
+		{
+			// decoded tuple is kept across messages, so that its strings and arrays are reused
+			typedDecoder = [callback = std::move(callback), values = std::tuple<Ts...>()](
+				const uint8_t* message, size_t size) mutable -> bool
+				{
+					if (!typedSignature<Ts...>::fromBinary(message, size, values)) return false;
+					if (callback) callback(values);
+					return true;
+				};
+		}
+
 		~dataSubscriber() override
 		{
 			stopDataFlow();
 		};
 
-		bool parseMessage(std::vector<uint8_t> message) override
+		bool parseMessage(const uint8_t* message, size_t size) override
 		{
 			spdlog::debug("dataSubscriber: parsing message");
 			switch (sectionID)
 			{
 			case 0:
 				{
-					uint32_t mVal = bytesToUint32(message.data(), true);
-					sectionLen = mVal % 16777216;
+					readFrameHeader(message, &sectionFlag, &sectionLen);
 					if (sectionLen > 0)
 					{
 						sectionID = 1;
 					}
 					else
 					{
-						if (mSignature.size() > 0)
+						if (mSignature.fieldCount() > 0)
 						{
 							spdlog::error("dataSubscriber: error in RPC message parsing: invalid message");
 							return false;
 						}
-						variantVector noV;
-						if (callbackFunction) callbackFunction(noV);
+						if (typedDecoder)
+						{
+							typedDecoder(nullptr, 0);
+						}
+						else if (viewCallbackFunction)
+						{
+							viewArgs.clear();
+							viewCallbackFunction(viewArgs);
+						}
+						else
+						{
+							variantVector noV;
+							if (callbackFunction) callbackFunction(noV);
+						}
 						sectionID = 0;
 						sectionLen = 4;
 					}
@@ -67,14 +197,68 @@ namespace rpcmple
 				}
 			case 1:
 				{
-					variantVector args;
-					mSignature.fromBinary(message, args);
-					if (callbackFunction) callbackFunction(args);
-					if (mSignature.size() != args.size())
+					if (sectionFlag == columnBatch::batchFrameFlag)
+					{
+						if (!parseBatch(message, size, true)) return false;
+						sectionID = 0;
+						sectionLen = 4;
+						break;
+					}
+
+					if (sectionFlag == seriesCodec::deltaFrameFlag || sectionFlag == seriesCodec::keyframeFlag)
+					{
+						if (!series) series = std::make_unique<seriesCodec>(mSignature.chars());
+
+						// frames which cannot be decoded are dropped until the next keyframe
+						if (!series->decode(sectionFlag, message, size, seriesRecord))
+						{
+							sectionID = 0;
+							sectionLen = 4;
+							break;
+						}
+						message = seriesRecord.data();
+						size = seriesRecord.size();
+					}
+
+					if (batchCallbackFunction)
+					{
+						if (!parseBatch(message, size, false)) return false;
+						sectionID = 0;
+						sectionLen = 4;
+						break;
+					}
+
+					if (typedDecoder)
+					{
+						if (!typedDecoder(message, size))
+						{
+							spdlog::error("dataSubscriber: error in RPC message parsing: invalid message");
+							return false;
+						}
+						sectionID = 0;
+						sectionLen = 4;
+						break;
+					}
+
+					if (viewCallbackFunction)
+					{
+						if (!mSignature.fromBinaryView(message, size, viewArgs))
+						{
+							spdlog::error("dataSubscriber: error in RPC message parsing: invalid message");
+							return false;
+						}
+						viewCallbackFunction(viewArgs);
+						sectionID = 0;
+						sectionLen = 4;
+						break;
+					}
+
+					if (!mSignature.fromBinary(message, size, args) || mSignature.fieldCount() != args.size())
 					{
 						spdlog::error("dataSubscriber: error in RPC message parsing: invalid message");
 						return false;
 					}
+					if (callbackFunction) callbackFunction(args);
 					sectionID = 0;
 					sectionLen = 4;
 					break;
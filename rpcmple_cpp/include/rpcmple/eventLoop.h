@@ -0,0 +1,455 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include "messageManager.h"
+
+#include "spdlog/spdlog.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+namespace rpcmple
+{
+	/* eventLoop serves the messageManagers of many connections from a few threads through epoll, on Linux, instead
+	 * of a data flow thread per connection. A connection is a file descriptor, typically a socket, which the loop
+	 * makes non-blocking and owns from add on: it is closed when the connection ends or the loop stops.
+	 * Each connection is served by one loop thread, which reads, parses and writes replies. Frames posted from other
+	 * threads, as the calls of an rpcClient and the records of a dataPublisher, wake that thread up to write them.
+	 * Managers are run in duplex mode, see messageManager::enableDuplex, and are not given a connectionManager.
+	 * A manager must not be destroyed before its connection has ended, which is notified by onClose
+	 */
+	class eventLoop
+	{
+	private:
+		static constexpr int maxEvents = 256;
+		// reads of a connection per event, so that a busy connection does not hold the others back
+		static constexpr int maxReads = 16;
+
+		struct connection
+		{
+			uint64_t id;
+			int fd;
+			messageManager* manager;
+			// set while the connection is scheduled to write frames queued by its manager
+			std::shared_ptr<std::atomic<bool>> scheduled;
+			// frames taken from the manager queue, written from frameIndex at frameOffset on
+			std::vector<std::vector<uint8_t>> frames;
+			size_t frameIndex;
+			size_t frameOffset;
+			size_t takenBytes;
+			bool waitingWritable;
+		};
+
+		struct loopThread
+		{
+			int epollFd = -1;
+			int wakeFd = -1;
+			std::thread thread;
+			std::unordered_map<uint64_t, std::unique_ptr<connection>> connections;
+			std::vector<iovec> iov;
+
+			// connections added and scheduled by other threads, handed over under mtx
+			std::mutex mtx;
+			std::vector<std::unique_ptr<connection>> added;
+			std::vector<uint64_t> scheduled;
+			// connections scheduled by the loop thread itself
+			std::vector<uint64_t> scheduledHere;
+		};
+
+		std::vector<std::unique_ptr<loopThread>> threads;
+		std::atomic<bool> running;
+		std::atomic<size_t> nextThread;
+		std::atomic<uint64_t> nextId;
+
+		static inline thread_local loopThread* currentThread = nullptr;
+
+		static bool setNonBlocking(int fd)
+		{
+			int flags = fcntl(fd, F_GETFL, 0);
+			return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+		}
+
+		static void wake(loopThread* t)
+		{
+			uint64_t one = 1;
+			while (::write(t->wakeFd, &one, sizeof(one)) < 0 && errno == EINTR)
+			{
+			}
+		}
+
+		// called by a manager when frames are queued or it is stopped, from any thread
+		static void schedule(loopThread* t, uint64_t id, const std::shared_ptr<std::atomic<bool>>& scheduled)
+		{
+			if (scheduled->exchange(true)) return;
+			if (currentThread == t)
+			{
+				t->scheduledHere.push_back(id);
+				return;
+			}
+
+			bool wasEmpty;
+			{
+				std::lock_guard<std::mutex> lock(t->mtx);
+				wasEmpty = t->scheduled.empty() && t->added.empty();
+				t->scheduled.push_back(id);
+			}
+			if (wasEmpty) wake(t);
+		}
+
+		void setWritable(loopThread* t, uint64_t id, connection& c, bool waiting)
+		{
+			if (c.waitingWritable == waiting) return;
+			epoll_event event{};
+			event.events = EPOLLIN;
+			if (waiting) event.events |= EPOLLOUT;
+			event.data.u64 = id;
+			epoll_ctl(t->epollFd, EPOLL_CTL_MOD, c.fd, &event);
+			c.waitingWritable = waiting;
+		}
+
+		// reads what is available and parses it, returns false if the connection must be closed
+		static bool readReady(connection& c)
+		{
+			for (int reads = 0; reads < maxReads; reads++)
+			{
+				uint8_t* data;
+				uint32_t size;
+				if (!c.manager->readSpace(&data, &size)) return false;
+
+				ssize_t n = ::read(c.fd, data, size);
+				if (n > 0)
+				{
+					if (!c.manager->received(static_cast<uint32_t>(n))) return false;
+					if (static_cast<size_t>(n) < size) return true;
+				}
+				else if (n == 0)
+				{
+					spdlog::debug("eventLoop: connection closed by the other process");
+					return false;
+				}
+				else if (errno != EINTR)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+					spdlog::debug("eventLoop: cannot read, closing connection");
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/* writes the frames queued by the manager until none is left or the connection is not writable, in which
+		 * case the connection waits to be writable. Returns false if the connection must be closed
+		 */
+		bool writeReady(loopThread* t, uint64_t id, connection& c)
+		{
+			while (true)
+			{
+				if (c.frameIndex == c.frames.size())
+				{
+					for (std::vector<uint8_t>& frames : c.frames) c.manager->releaseBuffer(std::move(frames));
+					c.frames.clear();
+					c.frameIndex = 0;
+					c.frameOffset = 0;
+					if (c.takenBytes > 0) c.manager->queueWritten(c.takenBytes, true);
+					c.takenBytes = 0;
+
+					// frames queued from now on schedule the connection again
+					c.scheduled->store(false);
+					if (!c.manager->takeQueued(c.frames, &c.takenBytes)) return false;
+					if (c.frames.empty())
+					{
+						setWritable(t, id, c, false);
+						return true;
+					}
+				}
+
+				t->iov.clear();
+				for (size_t i = c.frameIndex; i < c.frames.size() && t->iov.size() < IOV_MAX; i++)
+				{
+					size_t offset = i == c.frameIndex ? c.frameOffset : 0;
+					t->iov.push_back({c.frames[i].data() + offset, c.frames[i].size() - offset});
+				}
+
+				ssize_t n = ::writev(c.fd, t->iov.data(), static_cast<int>(t->iov.size()));
+				if (n < 0)
+				{
+					if (errno == EINTR) continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						setWritable(t, id, c, true);
+						return true;
+					}
+					spdlog::error("eventLoop: cannot write, closing connection");
+					return false;
+				}
+
+				size_t written = static_cast<size_t>(n);
+				while (written > 0)
+				{
+					size_t left = c.frames[c.frameIndex].size() - c.frameOffset;
+					if (written < left)
+					{
+						c.frameOffset += written;
+						break;
+					}
+					written -= left;
+					c.frameIndex++;
+					c.frameOffset = 0;
+				}
+			}
+		}
+
+		void closeConnection(loopThread* t, uint64_t id)
+		{
+			auto it = t->connections.find(id);
+			if (it == t->connections.end()) return;
+			std::unique_ptr<connection> c = std::move(it->second);
+			t->connections.erase(it);
+
+			epoll_ctl(t->epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+			::close(c->fd);
+			c->manager->detachLoop();
+		}
+
+		// registers the connections added and writes those scheduled by other threads
+		void serveHandedOver(loopThread* t)
+		{
+			std::vector<std::unique_ptr<connection>> added;
+			std::vector<uint64_t> scheduled;
+			{
+				std::lock_guard<std::mutex> lock(t->mtx);
+				added.swap(t->added);
+				scheduled.swap(t->scheduled);
+			}
+
+			for (std::unique_ptr<connection>& c : added)
+			{
+				uint64_t id = c->id;
+				epoll_event event{};
+				event.events = EPOLLIN;
+				event.data.u64 = id;
+				if (epoll_ctl(t->epollFd, EPOLL_CTL_ADD, c->fd, &event) != 0)
+				{
+					spdlog::error("eventLoop: cannot watch connection");
+					::close(c->fd);
+					c->manager->detachLoop();
+					continue;
+				}
+				t->connections.emplace(id, std::move(c));
+				// frames posted before the connection was watched
+				scheduled.push_back(id);
+			}
+
+			scheduled.insert(scheduled.end(), t->scheduledHere.begin(), t->scheduledHere.end());
+			t->scheduledHere.clear();
+			for (uint64_t id : scheduled)
+			{
+				auto it = t->connections.find(id);
+				if (it == t->connections.end()) continue;
+				connection& c = *it->second;
+				if (c.manager->stopping() || !writeReady(t, id, c)) closeConnection(t, id);
+			}
+		}
+
+		void run(loopThread* t)
+		{
+			currentThread = t;
+			epoll_event events[maxEvents];
+			while (running)
+			{
+				serveHandedOver(t);
+
+				int count = epoll_wait(t->epollFd, events, maxEvents, -1);
+				if (count < 0)
+				{
+					if (errno == EINTR) continue;
+					spdlog::error("eventLoop: epoll_wait failed, stopping loop thread");
+					break;
+				}
+
+				for (int i = 0; i < count; i++)
+				{
+					uint64_t id = events[i].data.u64;
+					if (id == 0)
+					{
+						uint64_t value;
+						while (::read(t->wakeFd, &value, sizeof(value)) < 0 && errno == EINTR)
+						{
+						}
+						continue;
+					}
+
+					auto it = t->connections.find(id);
+					if (it == t->connections.end()) continue;
+					connection& c = *it->second;
+
+					bool open = true;
+					if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) open = readReady(c);
+					// replies queued while reading are written right away
+					if (open && ((events[i].events & EPOLLOUT) || c.scheduled->load())) open = writeReady(t, id, c);
+					if (!open || c.manager->stopping()) closeConnection(t, id);
+				}
+			}
+			currentThread = nullptr;
+		}
+
+		// closes the epoll and wake up descriptors of the loop threads, also those created by a start which failed
+		void closeDescriptors()
+		{
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				if (t->epollFd >= 0) ::close(t->epollFd);
+				if (t->wakeFd >= 0) ::close(t->wakeFd);
+				t->epollFd = -1;
+				t->wakeFd = -1;
+			}
+		}
+
+	public:
+		// threadCount loop threads are started by start, connections are spread over them
+		explicit eventLoop(size_t threadCount = 1)
+			: running(false), nextThread(0), nextId(1)
+		{
+			for (size_t i = 0; i < std::max<size_t>(threadCount, 1); i++)
+			{
+				threads.push_back(std::make_unique<loopThread>());
+			}
+		}
+
+		eventLoop(const eventLoop&) = delete;
+		eventLoop& operator=(const eventLoop&) = delete;
+
+		~eventLoop()
+		{
+			stop();
+		}
+
+		bool start()
+		{
+			if (running) return true;
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				t->epollFd = epoll_create1(EPOLL_CLOEXEC);
+				t->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+				if (t->epollFd < 0 || t->wakeFd < 0)
+				{
+					spdlog::error("eventLoop: cannot create epoll instance");
+					closeDescriptors();
+					return false;
+				}
+				epoll_event event{};
+				event.events = EPOLLIN;
+				event.data.u64 = 0;
+				if (epoll_ctl(t->epollFd, EPOLL_CTL_ADD, t->wakeFd, &event) != 0)
+				{
+					spdlog::error("eventLoop: cannot watch wake up descriptor");
+					closeDescriptors();
+					return false;
+				}
+			}
+
+			running = true;
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				t->thread = std::thread(&eventLoop::run, this, t.get());
+			}
+			return true;
+		}
+
+		/* serves manager on fd until the connection ends or the loop stops, when fd is closed and onClose is called.
+		 * The manager must not have started its own data flow
+		 */
+		bool add(int fd, messageManager* manager, std::function<void()> onClose = nullptr)
+		{
+			if (!setNonBlocking(fd))
+			{
+				spdlog::error("eventLoop: cannot make descriptor {} non-blocking", fd);
+				return false;
+			}
+
+			loopThread* t = threads[nextThread++ % threads.size()].get();
+			uint64_t id = nextId++;
+
+			auto c = std::make_unique<connection>();
+			c->id = id;
+			c->fd = fd;
+			c->manager = manager;
+			c->scheduled = std::make_shared<std::atomic<bool>>(false);
+			c->frameIndex = 0;
+			c->frameOffset = 0;
+			c->takenBytes = 0;
+			c->waitingWritable = false;
+			// frames can be posted from here on, they are written once the loop thread takes the connection
+			std::shared_ptr<std::atomic<bool>> flag = c->scheduled;
+			manager->attachLoop([t, id, flag] { schedule(t, id, flag); }, std::move(onClose));
+
+			{
+				std::lock_guard<std::mutex> lock(t->mtx);
+				t->added.push_back(std::move(c));
+			}
+			if (running) wake(t);
+			return true;
+		}
+
+		// stops the loop threads and closes every connection
+		void stop()
+		{
+			if (!running.exchange(false)) return;
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				wake(t.get());
+			}
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				if (t->thread.joinable()) t->thread.join();
+			}
+
+			for (std::unique_ptr<loopThread>& t : threads)
+			{
+				std::vector<uint64_t> ids;
+				for (auto& entry : t->connections) ids.push_back(entry.first);
+				for (uint64_t id : ids) closeConnection(t.get(), id);
+
+				for (std::unique_ptr<connection>& c : t->added)
+				{
+					::close(c->fd);
+					c->manager->detachLoop();
+				}
+				t->added.clear();
+				t->scheduled.clear();
+				t->scheduledHere.clear();
+			}
+			closeDescriptors();
+		}
+	};
+}
+
+#endif //EVENTLOOP_H
@@ -0,0 +1,257 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace rpcmple
+{
+	/* frameCodec is the interface of the block compressors used by messageManager on frame bodies.
+	 * A codec instance is owned by a single messageManager and may keep state between calls. In duplex mode compress
+	 * and decompress are called from the writer and the reader thread at the same time, so they must not share it
+	 */
+	class frameCodec
+	{
+	public:
+		virtual ~frameCodec() = default;
+
+		// largest compressed size of size bytes
+		virtual size_t compressBound(size_t size) const =0;
+		// compresses src to dst, returns the compressed size or 0 if it does not fit capacity
+		virtual size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) =0;
+		// decompresses src to exactly dstSize bytes at dst, returns false if src is malformed
+		virtual bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize) =0;
+	};
+
+	/* lzCodec is a greedy LZ77 block compressor using the LZ4 block format: a sequence of token, literals, 16 bit
+	 * match offset. The token holds the literal length in the high nibble and the match length minus 4 in the
+	 * low nibble, a nibble of 15 is continued by bytes added to it until one is below 255. The last sequence
+	 * holds only literals. Matches are found through a hash table of 4 bytes prefixes
+	 */
+	class lzCodec : public frameCodec
+	{
+	private:
+		static constexpr unsigned hashLog = 12;
+		static constexpr size_t minMatch = 4;
+		static constexpr size_t maxOffset = 65535;
+		// the last bytes are always literals, so that a match is never extended past the end
+		static constexpr size_t lastLiterals = 5;
+		static constexpr size_t matchFindLimit = 12;
+
+		std::vector<uint32_t> hashTable;
+
+		static uint32_t load32(const uint8_t* src)
+		{
+			uint32_t val;
+			std::memcpy(&val, src, 4);
+			return val;
+		}
+
+		static uint64_t load64(const uint8_t* src)
+		{
+			uint64_t val;
+			std::memcpy(&val, src, 8);
+			return val;
+		}
+
+		static uint32_t hash(uint32_t seq)
+		{
+			return (seq * 2654435761U) >> (32 - hashLog);
+		}
+
+		// writes the continuation bytes of a length whose nibble is 15
+		static uint8_t* writeLengthBytes(size_t len, uint8_t* dst)
+		{
+			for (; len >= 255; len -= 255)
+			{
+				*dst++ = 255;
+			}
+			*dst++ = static_cast<uint8_t>(len);
+			return dst;
+		}
+
+		static bool readLengthBytes(const uint8_t* src, size_t size, size_t& offset, size_t* pLen)
+		{
+			uint8_t byte;
+			do
+			{
+				if (offset >= size) return false;
+				byte = src[offset++];
+				*pLen += byte;
+			}
+			while (byte == 255);
+			return true;
+		}
+
+		static size_t sequenceBound(size_t litLen, size_t matchLen)
+		{
+			return 1 + litLen + litLen / 255 + 1 + 2 + matchLen / 255 + 1;
+		}
+
+		static uint8_t* writeSequence(const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen,
+		                              uint8_t* dst)
+		{
+			uint8_t* token = dst++;
+			*token = static_cast<uint8_t>(std::min<size_t>(litLen, 15) << 4);
+			if (litLen >= 15) dst = writeLengthBytes(litLen - 15, dst);
+			if (litLen > 0) std::memcpy(dst, literals, litLen);
+			dst += litLen;
+
+			if (matchLen == 0) return dst;
+
+			*dst++ = static_cast<uint8_t>(offset);
+			*dst++ = static_cast<uint8_t>(offset >> 8);
+			matchLen -= minMatch;
+			*token |= static_cast<uint8_t>(std::min<size_t>(matchLen, 15));
+			if (matchLen >= 15) dst = writeLengthBytes(matchLen - 15, dst);
+			return dst;
+		}
+
+	public:
+		lzCodec() : hashTable(size_t(1) << hashLog)
+		{
+		}
+
+		size_t compressBound(size_t size) const override
+		{
+			return size + size / 255 + 16;
+		}
+
+		size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) override
+		{
+			uint8_t* op = dst;
+			uint8_t* opEnd = dst + capacity;
+			size_t anchor = 0;
+
+			if (size > matchFindLimit)
+			{
+				std::fill(hashTable.begin(), hashTable.end(), 0);
+				size_t ipLimit = size - matchFindLimit;
+				size_t matchLimit = size - lastLiterals;
+				size_t ip = 1;
+
+				while (ip < ipLimit)
+				{
+					uint32_t seq = load32(src + ip);
+					uint32_t& slot = hashTable[hash(seq)];
+					size_t ref = slot;
+					slot = static_cast<uint32_t>(ip);
+
+					if (ip - ref > maxOffset || load32(src + ref) != seq)
+					{
+						// skip faster through data which does not compress
+						ip += 1 + ((ip - anchor) >> 6);
+						continue;
+					}
+
+					while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+					{
+						ip--;
+						ref--;
+					}
+
+					size_t matchLen = minMatch;
+					while (ip + matchLen + 8 <= matchLimit && load64(src + ref + matchLen) == load64(src + ip + matchLen))
+					{
+						matchLen += 8;
+					}
+					while (ip + matchLen < matchLimit && src[ref + matchLen] == src[ip + matchLen])
+					{
+						matchLen++;
+					}
+
+					size_t litLen = ip - anchor;
+					if (static_cast<size_t>(opEnd - op) < sequenceBound(litLen, matchLen)) return 0;
+					op = writeSequence(src + anchor, litLen, ip - ref, matchLen, op);
+
+					ip += matchLen;
+					anchor = ip;
+					if (ip - 2 < ipLimit) hashTable[hash(load32(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+				}
+			}
+
+			size_t litLen = size - anchor;
+			if (static_cast<size_t>(opEnd - op) < sequenceBound(litLen, 0)) return 0;
+			op = writeSequence(src + anchor, litLen, 0, 0, op);
+			return op - dst;
+		}
+
+		bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize) override
+		{
+			size_t ip = 0;
+			size_t op = 0;
+
+			while (ip < size)
+			{
+				uint8_t token = src[ip++];
+
+				size_t litLen = token >> 4;
+				if (litLen == 15 && !readLengthBytes(src, size, ip, &litLen)) return false;
+				if (litLen > size - ip || litLen > dstSize - op) return false;
+				if (litLen > 0) std::memcpy(dst + op, src + ip, litLen);
+				ip += litLen;
+				op += litLen;
+
+				if (ip == size) break;
+
+				if (size - ip < 2) return false;
+				size_t offset = src[ip] | (src[ip + 1] << 8);
+				ip += 2;
+				if (offset == 0 || offset > op) return false;
+
+				size_t matchLen = token & 15;
+				if (matchLen == 15 && !readLengthBytes(src, size, ip, &matchLen)) return false;
+				matchLen += minMatch;
+				if (matchLen > dstSize - op) return false;
+
+				uint8_t* out = dst + op;
+				const uint8_t* ref = out - offset;
+				op += matchLen;
+				if (offset >= matchLen)
+				{
+					std::memcpy(out, ref, matchLen);
+				}
+				else if (offset >= 8)
+				{
+					// overlapping match, copied in chunks which do not overlap their source
+					for (; matchLen >= 8; matchLen -= 8, out += 8, ref += 8)
+					{
+						std::memcpy(out, ref, 8);
+					}
+					for (; matchLen > 0; matchLen--)
+					{
+						*out++ = *ref++;
+					}
+				}
+				else
+				{
+					for (; matchLen > 0; matchLen--)
+					{
+						*out++ = *ref++;
+					}
+				}
+			}
+			return op == dstSize;
+		}
+	};
+}
+
+#endif //FRAMECODEC_H
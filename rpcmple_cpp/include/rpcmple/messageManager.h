@@ -18,57 +18,624 @@
 
 //#include "connectionmanager/base.h"
 #include "rpcmple.h"
+#include "frameCodec.h"
+#include "readRing.h"
+#include "bufferPool.h"
 
 #include <cstdint>
 #include <utility>
 #include <vector>
 #include <thread>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 
 /* messageManager is a pure virtual class manages the flow of data with another rpcmple on a different process.
  * An implementation of messageManager must override the following methods:
  *  - parseMessage: it gets called when a byte sequence of len returned by GetMessageLen is read from the Reader.
  *  User implementing this function shall decode the byte sequence and return true if successful. Returning false
- *  will stop the communication loop.
+ *  will stop the communication loop. The bytes are valid only until parseMessage returns: they point into the read
+ *  buffer, which keeps the bytes of a sequence spanning several reads until it is complete.
  *  - getMessageLen gets called prior to read, for the messageManager to know the len of the message. A full message
  *  can be of variable len and can be split in multiple sub-messages. getMessageLen must return the len of the sub-message
  *  - writeMessage: it gets called after a message or sub-message is read, and after the call to ParseMessage.
  *  It shall serialize to the Buffer argument the data to be sent to the other process.
  *  It can leave the buffer empty if no reply must be sent. Return false if an encoding error occur.
- *  Returning false will stop the communication loop.
+ *  Returning false will stop the communication loop. The buffer is handed empty but recycled from previous frames,
+ *  so resizing or appending to it does not allocate once traffic is steady.
  *  stopParser gets called by the MessageManager when the StopDataFlow is called or the other application
  *  is closing the connection. It can be used to clean up the parser.
  * Constructor requires size if local buffer, maximum size of a message, connection through which read and write,
  * indication if this process should send the first message
+ *
+ * Messages are framed by a 4 bytes little endian header, whose top byte is a flag and whose lower 24 bits are the
+ * size of the body following it. When enableCompression is called, on both processes, bodies larger than a threshold
+ * are compressed and their frame flag is or-ed with compressedFrameFlag. The compressed body starts with the 4 bytes
+ * size of the original body. Compression requires writeMessage to write whole frames, and frame flags below 128
+ *
+ * When enableDuplex is called, messages are read and written on separate threads: the data flow thread reads and
+ * parses, and queues the replies of writeMessage, while a writer thread writes the queued frames. writeMessage is
+ * then only called after a message is parsed and must not wait for data; frames which do not reply to a message
+ * are queued from any thread with postMessage. On Linux an eventLoop can run the flow instead of these threads
  */
 
 namespace rpcmple
 {
 	class messageManager
 	{
+	protected:
+		static constexpr uint32_t frameHeaderSize = 4;
+		static constexpr uint32_t maxFrameBodySize = 16777215;
+		static constexpr uint32_t compressedFrameFlag = 0x80;
+
+		static void writeFrameHeader(uint32_t flag, size_t bodySize, uint8_t* dst)
+		{
+			uint32ToBytes(flag * 16777216 + static_cast<uint32_t>(bodySize), dst, true);
+		}
+
+		static void readFrameHeader(const uint8_t* src, uint32_t* pFlag, uint32_t* pBodySize)
+		{
+			uint32_t header = bytesToUint32(src, true);
+			*pFlag = header / 16777216;
+			*pBodySize = header % 16777216;
+		}
+
+		bool compressionEnabled() const { return codec != nullptr; }
+
+		// buffers for frames built outside writeMessage, which end up written by it, see bufferPool
+		std::vector<uint8_t> acquireBuffer() { return framePool.acquire(); }
+		void releaseBuffer(std::vector<uint8_t> buffer) { framePool.release(std::move(buffer)); }
+
+		/* adds size bytes at data to the message being written by writeMessage, after the bytes message holds so far,
+		 * without copying them. The bytes must stay valid until the message is written, which is before the next call
+		 * to writeMessage
+		 */
+		void appendSegment(const std::vector<uint8_t>& message, const uint8_t* data, size_t size)
+		{
+			if (size > 0) outSegments.push_back({message.size(), data, size});
+		}
+
+		bool duplexEnabled() const { return duplex; }
+
+		// tells whether the flow was asked to stop, safe to call from any thread
+		bool stopping() const { return stopRequested; }
+
+		/* queues whole frames to be written by the writer thread of duplex mode, taking over their buffer. It can be
+		 * called from any thread, and waits while the queue holds more than its maximum bytes. Returns false if the
+		 * flow is stopping
+		 */
+		bool postMessage(std::vector<uint8_t>&& frames)
+		{
+			return pushQueue(std::move(frames), true);
+		}
+
+		// waits until the frames queued in duplex mode are written, returns false if the flow stopped first
+		bool waitWritten()
+		{
+			std::unique_lock<std::mutex> lock(queueMtx);
+			queueCv.wait(lock, [this] { return (outQueue.empty() && !writing) || writerStop; });
+			return outQueue.empty() && !writing;
+		}
+
 	private:
+		friend class eventLoop;
+
 		bool isInitialized;
 
 		bool isRequester;
-		bool stopRequested;
+		// written by the threads of the flow and by stopDataFlow, read by the data flow thread or an eventLoop
+		std::atomic<bool> stopRequested;
+		// set by the first thread closing the connection, which the reader and the writer of duplex mode can both do
+		std::atomic<bool> connClosed;
 
 		rpcmple::connectionManager::base* mConn;
-		std::vector<uint8_t> readBuffer;
-		std::vector<uint8_t> message;
+		readRing readBuffer;
 		//uint32_t maxDatagramSize;
-		uint32_t messageLastIdx;
 		uint32_t messageLength;
-		uint32_t messageMissingBytes;
 
 		std::function<void()> onCloseCallback;
 
+		bufferPool framePool;
+
+		// segments added by writeMessage through appendSegment, at offset of the message bytes
+		struct outSegment
+		{
+			size_t offset;
+			const uint8_t* data;
+			size_t size;
+		};
+		std::vector<outSegment> outSegments;
+		std::vector<connectionManager::segment> gathered;
+		std::vector<uint8_t> flattened;
+
+		// frames held back to be written together, see enableWriteCoalescing
+		std::mutex outMtx;
+		size_t coalesceBytes;
+		std::chrono::steady_clock::duration coalesceDelay;
+		std::vector<uint8_t> pendingOut;
+		std::chrono::steady_clock::time_point pendingSince;
+
+		// frames queued for the writer thread, see enableDuplex
+		bool duplex;
+		size_t maxQueuedBytes;
+		std::mutex queueMtx;
+		std::condition_variable queueCv;
+		std::vector<std::vector<uint8_t>> outQueue;
+		size_t queuedBytes;
+		bool writing;
+		bool writerStop;
+		std::vector<connectionManager::segment> queuedSegments;
+		// set by an eventLoop, which writes the queued frames, to be woken up when frames are queued or on stop
+		std::function<void()> queueNotify;
+
+		std::unique_ptr<frameCodec> codec;
+		size_t compressionThreshold;
+		std::vector<uint8_t> deflated;
+		std::vector<uint8_t> inflated;
+		// compressed bytes as read, before they are inflated to the read buffer
+		std::vector<uint8_t> compressedRead;
+		// state of the incoming frame, which can span several reads
+		uint8_t inHeader[4];
+		uint32_t inHeaderFilled;
+		uint32_t inFlag;
+		uint32_t inMissing;
+		std::vector<uint8_t> inCompressed;
+
+		// compresses the bodies of the frames in msg which are larger than the threshold and shrink
+		bool deflateFrames(std::vector<uint8_t>& msg)
+		{
+			deflated.clear();
+			size_t offset = 0;
+			while (offset < msg.size())
+			{
+				uint32_t flag, bodySize;
+				if (msg.size() - offset < frameHeaderSize)
+				{
+					spdlog::error("messageManager: cannot compress message: incomplete frame");
+					return false;
+				}
+				readFrameHeader(msg.data() + offset, &flag, &bodySize);
+				if (msg.size() - offset - frameHeaderSize < bodySize)
+				{
+					spdlog::error("messageManager: cannot compress message: incomplete frame");
+					return false;
+				}
+				if (flag & compressedFrameFlag)
+				{
+					spdlog::error("messageManager: frame flag {} conflicts with compression", flag);
+					return false;
+				}
+
+				const uint8_t* body = msg.data() + offset + frameHeaderSize;
+				if (bodySize >= compressionThreshold)
+				{
+					size_t frameBegin = deflated.size();
+					size_t capacity = codec->compressBound(bodySize);
+					deflated.resize(frameBegin + frameHeaderSize + 4 + capacity);
+					size_t packedSize = codec->compress(body, bodySize, deflated.data() + frameBegin + frameHeaderSize + 4,
+					                                    capacity);
+					if (packedSize > 0 && packedSize + 4 < bodySize)
+					{
+						writeFrameHeader(flag | compressedFrameFlag, packedSize + 4, deflated.data() + frameBegin);
+						uint32ToBytes(bodySize, deflated.data() + frameBegin + frameHeaderSize, true);
+						deflated.resize(frameBegin + frameHeaderSize + 4 + packedSize);
+						offset += frameHeaderSize + bodySize;
+						continue;
+					}
+					deflated.resize(frameBegin);
+				}
+				deflated.insert(deflated.end(), body - frameHeaderSize, body + bodySize);
+				offset += frameHeaderSize + bodySize;
+			}
+			msg.swap(deflated);
+			return true;
+		}
+
+		// restores the frames in data to inflated, decompressing the compressed ones. Frames can span several calls
+		bool inflateFrames(const uint8_t* data, size_t size)
+		{
+			inflated.clear();
+			size_t offset = 0;
+			while (offset < size)
+			{
+				if (inHeaderFilled < frameHeaderSize)
+				{
+					size_t headerBytes = std::min<size_t>(frameHeaderSize - inHeaderFilled, size - offset);
+					std::memcpy(inHeader + inHeaderFilled, data + offset, headerBytes);
+					inHeaderFilled += headerBytes;
+					offset += headerBytes;
+					if (inHeaderFilled < frameHeaderSize) break;
+
+					readFrameHeader(inHeader, &inFlag, &inMissing);
+					if (inFlag & compressedFrameFlag)
+					{
+						if (inMissing < 4)
+						{
+							spdlog::error("messageManager: invalid compressed frame");
+							return false;
+						}
+						inCompressed.clear();
+					}
+					else
+					{
+						inflated.insert(inflated.end(), inHeader, inHeader + frameHeaderSize);
+					}
+				}
+
+				size_t bodyBytes = std::min<size_t>(inMissing, size - offset);
+				if (inFlag & compressedFrameFlag) inCompressed.insert(inCompressed.end(), data + offset, data + offset + bodyBytes);
+				else inflated.insert(inflated.end(), data + offset, data + offset + bodyBytes);
+				offset += bodyBytes;
+				inMissing -= bodyBytes;
+
+				if (inMissing == 0)
+				{
+					inHeaderFilled = 0;
+					if ((inFlag & compressedFrameFlag) && !inflateFrame()) return false;
+				}
+			}
+			return true;
+		}
+
+		bool inflateFrame()
+		{
+			uint32_t bodySize = bytesToUint32(inCompressed.data(), true);
+			if (bodySize > maxFrameBodySize)
+			{
+				spdlog::error("messageManager: invalid compressed frame");
+				return false;
+			}
+
+			size_t frameBegin = inflated.size();
+			inflated.resize(frameBegin + frameHeaderSize + bodySize);
+			writeFrameHeader(inFlag & ~compressedFrameFlag, bodySize, inflated.data() + frameBegin);
+			if (!codec->decompress(inCompressed.data() + 4, inCompressed.size() - 4,
+			                       inflated.data() + frameBegin + frameHeaderSize, bodySize))
+			{
+				spdlog::error("messageManager: invalid compressed frame");
+				return false;
+			}
+			return true;
+		}
+
+		// size of msg with the segments added by writeMessage
+		size_t outgoingSize(const std::vector<uint8_t>& msg) const
+		{
+			size_t size = msg.size();
+			for (const outSegment& seg : outSegments) size += seg.size;
+			return size;
+		}
+
+		// lists the bytes of msg interleaved with the segments added by writeMessage
+		void gatherSegments(const std::vector<uint8_t>& msg)
+		{
+			gathered.clear();
+			size_t offset = 0;
+			for (const outSegment& seg : outSegments)
+			{
+				if (seg.offset > offset) gathered.push_back({msg.data() + offset, seg.offset - offset});
+				gathered.push_back({seg.data, seg.size});
+				offset = seg.offset;
+			}
+			if (msg.size() > offset) gathered.push_back({msg.data() + offset, msg.size() - offset});
+		}
+
+		// writes msg to the connection, compressing it first when enabled
+		bool writeFrames(std::vector<uint8_t>& msg)
+		{
+			if (outSegments.empty())
+			{
+				if (codec && !deflateFrames(msg)) return false;
+				return mConn->write(msg);
+			}
+
+			gatherSegments(msg);
+			outSegments.clear();
+			if (!codec) return mConn->writeSegments(gathered.data(), gathered.size());
+
+			// frames are compressed from a single buffer
+			flattened.clear();
+			for (const connectionManager::segment& seg : gathered)
+			{
+				flattened.insert(flattened.end(), seg.data, seg.data + seg.size);
+			}
+			if (!deflateFrames(flattened)) return false;
+			return mConn->write(flattened);
+		}
+
+		// writes the frames held back by write coalescing, with outMtx locked
+		bool flushPending()
+		{
+			if (pendingOut.empty()) return true;
+			bool written = (!codec || deflateFrames(pendingOut)) && mConn->write(pendingOut);
+			pendingOut.clear();
+			return written;
+		}
+
+		/* writes msg to the connection. With write coalescing, a message smaller than the threshold is copied after
+		 * the pending frames, which are written when they reach the threshold or the oldest is older than the delay
+		 */
+		bool sendMessage(std::vector<uint8_t>& msg)
+		{
+			std::lock_guard<std::mutex> lock(outMtx);
+			size_t size = outgoingSize(msg);
+			if (coalesceBytes == 0 || size >= coalesceBytes)
+			{
+				return flushPending() && writeFrames(msg);
+			}
+
+			if (pendingOut.size() + size > coalesceBytes && !flushPending()) return false;
+			auto now = std::chrono::steady_clock::now();
+			if (pendingOut.empty()) pendingSince = now;
+			gatherSegments(msg);
+			outSegments.clear();
+			for (const connectionManager::segment& seg : gathered)
+			{
+				pendingOut.insert(pendingOut.end(), seg.data, seg.data + seg.size);
+			}
+
+			if (pendingOut.size() >= coalesceBytes || now - pendingSince >= coalesceDelay) return flushPending();
+			return true;
+		}
+
+		// queues frames, waiting while the queue is full if wait is set
+		bool pushQueue(std::vector<uint8_t>&& frames, bool wait)
+		{
+			if (frames.empty()) return true;
+			{
+				std::unique_lock<std::mutex> lock(queueMtx);
+				if (wait) queueCv.wait(lock, [this] { return queuedBytes < maxQueuedBytes || writerStop; });
+				if (writerStop) return false;
+				queuedBytes += frames.size();
+				outQueue.push_back(std::move(frames));
+			}
+			queueCv.notify_all();
+			if (queueNotify) queueNotify();
+			return true;
+		}
+
+		/* moves the queued frames to queued, compressing them when enabled, and sets the bytes taken, which are
+		 * given back to queueWritten once written
+		 */
+		bool takeQueued(std::vector<std::vector<uint8_t>>& queued, size_t* pTakenBytes)
+		{
+			{
+				std::lock_guard<std::mutex> lock(queueMtx);
+				queued.swap(outQueue);
+				*pTakenBytes = queuedBytes;
+				writing = !queued.empty();
+			}
+			if (!codec) return true;
+
+			std::lock_guard<std::mutex> lock(outMtx);
+			for (std::vector<uint8_t>& frames : queued)
+			{
+				if (!deflateFrames(frames)) return false;
+			}
+			return true;
+		}
+
+		// ends the write of the frames taken by takeQueued, stopping the flow if they could not be written
+		void queueWritten(size_t takenBytes, bool written)
+		{
+			{
+				std::lock_guard<std::mutex> lock(queueMtx);
+				queuedBytes -= takenBytes;
+				writing = false;
+				if (!written) writerStop = true;
+			}
+			queueCv.notify_all();
+		}
+
+		// queues a reply of writeMessage in duplex mode, copying it with its segments to a buffer of its own
+		bool queueMessage(std::vector<uint8_t>& msg)
+		{
+			if (!outSegments.empty())
+			{
+				std::vector<uint8_t> frames = framePool.acquire();
+				gatherSegments(msg);
+				outSegments.clear();
+				for (const connectionManager::segment& seg : gathered)
+				{
+					frames.insert(frames.end(), seg.data, seg.data + seg.size);
+				}
+				msg.swap(frames);
+				framePool.release(std::move(frames));
+			}
+			// the thread of an eventLoop writes the queue itself, so it cannot wait for it
+			return pushQueue(std::move(msg), !queueNotify);
+		}
+
+		// writes the frames taken from the queue in one call
+		bool writeQueued(std::vector<std::vector<uint8_t>>& queued)
+		{
+			std::lock_guard<std::mutex> lock(outMtx);
+			if (queued.size() == 1) return mConn->write(queued[0]);
+
+			queuedSegments.clear();
+			for (const std::vector<uint8_t>& frames : queued) queuedSegments.push_back({frames.data(), frames.size()});
+			return mConn->writeSegments(queuedSegments.data(), queuedSegments.size());
+		}
+
+		// writer thread of duplex mode: writes everything queued since its last write, until the flow stops
+		void writeFlow()
+		{
+			std::vector<std::vector<uint8_t>> queued;
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(queueMtx);
+					queueCv.wait(lock, [this] { return !outQueue.empty() || writerStop; });
+					// queued frames are still written when the flow stops
+					if (outQueue.empty()) break;
+				}
+
+				size_t takenBytes;
+				bool written = takeQueued(queued, &takenBytes) && writeQueued(queued);
+				for (std::vector<uint8_t>& frames : queued) framePool.release(std::move(frames));
+				queued.clear();
+				queueWritten(takenBytes, written);
+
+				if (!written)
+				{
+					spdlog::error("messageManager: error sending queued messages; stopping flow");
+					stopRequested = true;
+					stopParser();
+					// the data flow thread is woken up from reading, to end the flow
+					closeConnection();
+					break;
+				}
+			}
+		}
+
+		// free space of the read buffer to read the next bytes to, which are then passed to received
+		bool readSpace(uint8_t** pData, uint32_t* pSize)
+		{
+			if (readBuffer.trim())
+			{
+				// the decompression buffers grew with the largest frames, they go back with the read buffer
+				std::vector<uint8_t>().swap(compressedRead);
+				std::vector<uint8_t>().swap(inflated);
+				if (inHeaderFilled == 0) std::vector<uint8_t>().swap(inCompressed);
+			}
+			if (!readBuffer.reserve(messageLength))
+			{
+				spdlog::error("messageManager: message of {} bytes exceeds the read buffer size; stopping flow",
+				              messageLength);
+				return false;
+			}
+
+			size_t size = std::min<size_t>(readBuffer.writeSize(), UINT32_MAX);
+			if (codec)
+			{
+				compressedRead.resize(size);
+				*pData = compressedRead.data();
+			}
+			else
+			{
+				*pData = readBuffer.writeData();
+			}
+			*pSize = static_cast<uint32_t>(size);
+			return true;
+		}
+
+		/* parses the messages completed by bytesRead bytes read to readSpace, and writes or queues their replies.
+		 * Returns false if the flow must stop
+		 */
+		bool received(uint32_t bytesRead)
+		{
+			const uint8_t* pending = nullptr;
+			size_t pendingSize = 0;
+			if (codec)
+			{
+				if (!inflateFrames(compressedRead.data(), bytesRead))
+				{
+					spdlog::error("messageManager: error decompressing received message; stopping flow");
+					return false;
+				}
+				pending = inflated.data();
+				pendingSize = inflated.size();
+			}
+			else
+			{
+				readBuffer.commit(bytesRead);
+			}
+
+			do
+			{
+				// inflated bytes are appended as the messages parsed make room for them, up to the maximum size
+				if (pendingSize > 0)
+				{
+					size_t appended = readBuffer.append(pending, pendingSize);
+					if (appended == 0)
+					{
+						spdlog::error("messageManager: message of {} bytes exceeds the read buffer size; stopping flow",
+						              messageLength);
+						return false;
+					}
+					pending += appended;
+					pendingSize -= appended;
+				}
+
+				// messages are parsed in place, the bytes of an incomplete one are kept for the next read
+				while (messageLength > 0 && readBuffer.size() >= messageLength)
+				{
+					bool parsed = parseMessage(readBuffer.data(), messageLength);
+					readBuffer.consume(messageLength);
+					if (!parsed)
+					{
+						spdlog::error("messageManager: error parsing received message; stopping flow");
+						stopRequested = true;
+						return false;
+					}
+
+					std::vector<uint8_t> replyMessage = framePool.acquire();
+					if (!writeMessage(replyMessage))
+					{
+						spdlog::error("messageManager: error generating reply message; stopping flow");
+						stopRequested = true;
+						return false;
+					}
+					if (outgoingSize(replyMessage) > 0)
+					{
+						if (outgoingSize(replyMessage) > 16777220)
+						{
+							spdlog::error("messageManager: message too large; stopping flow");
+							stopRequested = true;
+							return false;
+						}
+						if (!(duplex ? queueMessage(replyMessage) : sendMessage(replyMessage)))
+						{
+							spdlog::error("messageManager: error sending reply message; stopping flow");
+							stopRequested = true;
+							return false;
+						}
+					}
+					framePool.release(std::move(replyMessage));
+
+					messageLength = getMessageLen();
+				}
+			} while (pendingSize > 0);
+			return true;
+		}
+
+		// hands the flow over to an eventLoop, which calls notify when frames are queued or the flow is stopped
+		void attachLoop(std::function<void()> notify, std::function<void()> onClose)
+		{
+			duplex = true;
+			if (maxQueuedBytes == 0) maxQueuedBytes = 16777216;
+			queueNotify = std::move(notify);
+			onCloseCallback = std::move(onClose);
+			if (!isInitialized) init();
+		}
+
+		// ends the flow run by an eventLoop, whose connection is closed
+		void detachLoop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(queueMtx);
+				writerStop = true;
+				writing = false;
+			}
+			queueCv.notify_all();
+			// threads waiting for replies or for queued data are woken up
+			stopParser();
+			if (onCloseCallback) onCloseCallback();
+			spdlog::debug("messageManager: flow stopped");
+		}
+
+		void closeConnection()
+		{
+			if (!connClosed.exchange(true)) mConn->close();
+		}
+
 		void init()
 		{
-			readBuffer.resize(16777220);
-			messageLastIdx = 0;
 			messageLength = getMessageLen();
-			message.resize(messageLength);
-			messageMissingBytes = messageLength;
+			inHeaderFilled = 0;
 			isInitialized = true;
 		}
 
@@ -79,10 +646,14 @@ namespace rpcmple
 				init();
 			}
 
-			if (isRequester)
+			std::thread writer;
+			if (duplex) writer = std::thread(&messageManager::writeFlow, this);
+
+			// in duplex mode the first message is posted rather than waited for by writeMessage
+			if (isRequester && !duplex)
 			{
 				spdlog::debug("messageManager: waiting to write first message");
-				std::vector<uint8_t> message;
+				std::vector<uint8_t> message = framePool.acquire();
 				if (!writeMessage(message))
 				{
 					spdlog::error("messageManager: error generating initial message; stopping flow");
@@ -90,16 +661,16 @@ namespace rpcmple
 				}
 				else
 				{
-					if (!message.empty())
+					if (outgoingSize(message) > 0)
 					{
-						if (message.size() > 16777220)
+						if (outgoingSize(message) > 16777220)
 						{
 							spdlog::error("messageManager: initial message too large; stopping flow");
 							stopRequested = true;
 						}
 						else
 						{
-							if (!mConn->write(message))
+							if (!sendMessage(message))
 							{
 								spdlog::error("messageManager: error sending initial message; stopping flow");
 								stopRequested = true;
@@ -107,105 +678,76 @@ namespace rpcmple
 						}
 					}
 				}
+				framePool.release(std::move(message));
 			}
 
-			uint32_t bytesRead = 0;
-			uint32_t bytesParsed = 0;
-
 			while (!stopRequested)
 			{
 				spdlog::debug("messageManager: entering main data flow");
-				bytesRead = 0;
-				bytesParsed = 0;
+
+				if (duplex && messageLength == 0)
+				{
+					// nothing to read, frames are posted and written by the writer thread until the flow stops
+					std::unique_lock<std::mutex> lock(queueMtx);
+					queueCv.wait(lock, [this] { return stopRequested || writerStop; });
+					break;
+				}
 
 				if (messageLength > 0)
 				{
-					//readBuffer.resize(messageMissingBytes);
-					if (!mConn->read(readBuffer, &bytesRead))
+					// nothing else is written until a message is read
+					if (!flush())
 					{
-						spdlog::debug("messageManager: cannot read, stopping flow");
+						spdlog::error("messageManager: error sending reply message; stopping flow");
 						break;
 					}
 
-					while (bytesParsed<bytesRead)
-					{
-						uint32_t transferredBytes = messageMissingBytes;
-						if (bytesRead-bytesParsed < transferredBytes)
-						{
-							transferredBytes = bytesRead-bytesParsed;
-						}
-						std::copy(readBuffer.begin() + bytesParsed, readBuffer.begin() + bytesParsed + transferredBytes,
-						          message.begin() + messageLastIdx);
-
-						messageLastIdx += transferredBytes;
-						messageMissingBytes -= transferredBytes;
-						bytesParsed += transferredBytes;
-						//fakeBuffer.erase(fakeBuffer.begin(), fakeBuffer.begin() + transferredBytes);
-
-						if (messageMissingBytes == 0)
-						{
-							if (!parseMessage({message.begin(), message.begin() + messageLength}))
-							{
-								spdlog::error("messageManager: error parsing received message; stopping flow");
-								stopRequested = true;
-								break;
-							}
-
-							std::vector<uint8_t> replyMessage(1024);
-							if (!writeMessage(replyMessage))
-							{
-								spdlog::error("messageManager: error generating reply message; stopping flow");
-								stopRequested = true;
-								break;
-							}
-							if (!replyMessage.empty())
-							{
-								if (message.size() > 16777220)
-								{
-									spdlog::error("messageManager: message too large; stopping flow");
-									stopRequested = true;
-									break;
-								}
-								if (!mConn->write(replyMessage))
-								{
-									spdlog::error("messageManager: error sending reply message; stopping flow");
-									stopRequested = true;
-									break;
-								}
-							}
+					uint8_t* readData;
+					uint32_t readSize;
+					if (!readSpace(&readData, &readSize)) break;
 
-							messageLastIdx = 0;
-							messageLength = getMessageLen();
-							message.resize(messageLength);
-							messageMissingBytes = messageLength;
-						}
+					uint32_t bytesRead = 0;
+					if (!mConn->readInto(readData, readSize, &bytesRead))
+					{
+						spdlog::debug("messageManager: cannot read, stopping flow");
+						break;
 					}
+					if (!received(bytesRead)) break;
 				}
 				else
 				{
-					std::vector<uint8_t> message;
+					std::vector<uint8_t> message = framePool.acquire();
 					if (!writeMessage(message))
 					{
 						spdlog::error("messageManager: error sending reply message; stopping flow");
 						stopRequested = true;
 						break;
 					}
-					if (!message.empty())
+					if (outgoingSize(message) > 0)
 					{
-						if (!mConn->write(message))
+						if (!sendMessage(message))
 						{
 							spdlog::error("messageManager: error sending reply message; stopping flow");
 							stopRequested = true;
 							break;
 						}
 					}
+					framePool.release(std::move(message));
 
-					messageLastIdx = 0;
 					messageLength = getMessageLen();
-					messageMissingBytes = messageLength;
 				}
 			}
-			mConn->close();
+			flush();
+			if (duplex)
+			{
+				{
+					std::lock_guard<std::mutex> lock(queueMtx);
+					writerStop = true;
+				}
+				queueCv.notify_all();
+				writer.join();
+			}
+			closeConnection();
 			if (onCloseCallback) onCloseCallback();
 			spdlog::warn("messageManager: flow stopped");
 		}
@@ -215,18 +757,82 @@ namespace rpcmple
 		{
 			isInitialized = false;
 			stopRequested = false;
+			connClosed = false;
 
 			isRequester = requester;
 			mConn = pConn;
+			coalesceBytes = 0;
+			duplex = false;
+			maxQueuedBytes = 0;
+			queuedBytes = 0;
+			writing = false;
+			writerStop = false;
+			compressionThreshold = 0;
+			inHeaderFilled = 0;
 		}
 
 		virtual ~messageManager() = default;
 
-		virtual bool parseMessage(std::vector<uint8_t> message) =0;
+		virtual bool parseMessage(const uint8_t* message, size_t size) =0;
 		virtual int getMessageLen() =0;
 		virtual bool writeMessage(std::vector<uint8_t>& message) =0;
 		virtual void stopParser() =0;
 
+		// number of frame flags the derived class writes, from 0. Compression can only be enabled below 128 flags
+		virtual uint32_t frameFlagCount() const { return 0; }
+
+		/* compresses the bodies of outgoing frames of at least threshold bytes with codec, and decompresses incoming
+		 * frames flagged as compressed. It must be called on both processes before starting the data flow
+		 */
+		void enableCompression(size_t threshold = 512, std::unique_ptr<frameCodec> codec = std::make_unique<lzCodec>())
+		{
+			compressionThreshold = threshold;
+			this->codec = std::move(codec);
+			if (frameFlagCount() > compressedFrameFlag)
+			{
+				spdlog::warn("messageManager: frame flags from {} to {} cannot be used with compression enabled",
+				             compressedFrameFlag, frameFlagCount() - 1);
+			}
+		}
+
+		/* sets the size the read buffer starts from and is shrunk back to, the largest message it can grow to, and how
+		 * long it stays grown after the last larger message. It must be called before starting the data flow
+		 */
+		void setReadBuffer(size_t initialSize, size_t maxSize,
+		                   std::chrono::steady_clock::duration shrinkDelay = std::chrono::seconds(10))
+		{
+			readBuffer.setLimits(initialSize, maxSize, shrinkDelay);
+		}
+
+		/* holds back messages smaller than maxBytes to write them together, when they reach maxBytes, when the oldest
+		 * is older than maxDelay, or before the flow waits to read. A writeMessage which blocks waiting for data must
+		 * call flush first, as dataPublisher does. It must be called before starting the data flow
+		 */
+		void enableWriteCoalescing(size_t maxBytes = 16384,
+		                           std::chrono::steady_clock::duration maxDelay = std::chrono::microseconds(50))
+		{
+			coalesceBytes = maxBytes;
+			coalesceDelay = maxDelay;
+		}
+
+		/* reads and writes on separate threads, so that sending does not wait for the reply of the other process to
+		 * be read and the other way around. Frames waiting to be written are queued up to maxQueuedBytes, beyond
+		 * which posting waits for the writer. Write coalescing is not used, as the writer writes all frames queued
+		 * since its last write at once. It must be called before starting the data flow
+		 */
+		void enableDuplex(size_t maxQueuedBytes = 16777216)
+		{
+			duplex = true;
+			this->maxQueuedBytes = maxQueuedBytes;
+		}
+
+		// writes the messages held back by write coalescing. It can be called from any thread
+		bool flush()
+		{
+			std::lock_guard<std::mutex> lock(outMtx);
+			return flushPending();
+		}
+
 		void startDataFlowNonBlocking(std::function<void()> onCloseCallback = nullptr)
 		{
 			this->onCloseCallback = std::move(onCloseCallback);
@@ -242,7 +848,12 @@ namespace rpcmple
 
 		void stopDataFlow()
 		{
-			stopRequested = true;
+			{
+				std::lock_guard<std::mutex> lock(queueMtx);
+				stopRequested = true;
+			}
+			queueCv.notify_all();
+			if (queueNotify) queueNotify();
 			stopParser();
 		}
 	};
@@ -0,0 +1,153 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef READRING_H
+#define READRING_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+namespace rpcmple
+{
+	/* readRing is the read buffer of a messageManager. Bytes are read after the unparsed ones and parsed where they
+	 * are, so a message must be contiguous: instead of wrapping around, the unparsed bytes are moved back to the
+	 * start when the end is reached, which only moves the part of a message read so far. The buffer starts at its
+	 * initial size, grows to the largest message it has to hold up to its maximum size, and is shrunk back to the
+	 * initial size when it is empty and no message larger than that has been read for the shrink delay
+	 */
+	class readRing
+	{
+	private:
+		std::vector<uint8_t> buffer;
+		size_t head;
+		size_t tail;
+
+		size_t initialSize;
+		size_t maxSize;
+		std::chrono::steady_clock::duration shrinkDelay;
+		std::chrono::steady_clock::time_point lastLargeUse;
+
+		// moves the unparsed bytes to a buffer of newSize bytes, at its start
+		void relocate(size_t newSize)
+		{
+			size_t used = tail - head;
+			if (newSize == buffer.size())
+			{
+				if (used > 0) std::memmove(buffer.data(), buffer.data() + head, used);
+			}
+			else
+			{
+				std::vector<uint8_t> relocated(newSize);
+				if (used > 0) std::memcpy(relocated.data(), buffer.data() + head, used);
+				buffer.swap(relocated);
+			}
+			head = 0;
+			tail = used;
+		}
+
+	public:
+		explicit readRing(size_t initialSize = 65536, size_t maxSize = 16777220,
+		                  std::chrono::steady_clock::duration shrinkDelay = std::chrono::seconds(10))
+			: head(0), tail(0), initialSize(initialSize), maxSize(std::max(initialSize, maxSize)),
+			  shrinkDelay(shrinkDelay)
+		{
+		}
+
+		// sets the limits of the buffer, which takes them on its next growth or shrink
+		void setLimits(size_t initial, size_t max, std::chrono::steady_clock::duration delay)
+		{
+			initialSize = initial;
+			maxSize = std::max(initial, max);
+			shrinkDelay = delay;
+		}
+
+		// unparsed bytes
+		const uint8_t* data() const { return buffer.data() + head; }
+		size_t size() const { return tail - head; }
+		size_t capacity() const { return buffer.size(); }
+
+		void consume(size_t n)
+		{
+			head += n;
+			if (head == tail)
+			{
+				head = 0;
+				tail = 0;
+			}
+		}
+
+		/* makes room to read after the unparsed bytes, holding at least messageSize bytes from the first unparsed
+		 * one. Returns false if messageSize exceeds the maximum size
+		 */
+		bool reserve(size_t messageSize)
+		{
+			size_t required = std::max(messageSize, size() + 1);
+			if (required > maxSize) return false;
+
+			if (required > initialSize) lastLargeUse = std::chrono::steady_clock::now();
+
+			if (buffer.size() - head >= required) return true;
+			if (buffer.size() >= required)
+			{
+				relocate(buffer.size());
+				return true;
+			}
+			size_t newSize = std::max(initialSize, buffer.size() * 2);
+			relocate(std::min(maxSize, std::max(newSize, required)));
+			return true;
+		}
+
+		// free space after the unparsed bytes, valid after reserve
+		uint8_t* writeData() { return buffer.data() + tail; }
+		size_t writeSize() const { return buffer.size() - tail; }
+		void commit(size_t n) { tail += n; }
+
+		/* copies up to size bytes after the unparsed ones, growing the buffer up to its maximum size, and returns how
+		 * many were copied. Fewer bytes are copied if the unparsed ones and size exceed the maximum size
+		 */
+		size_t append(const uint8_t* src, size_t size)
+		{
+			size = std::min(size, maxSize - std::min(maxSize, this->size()));
+			if (size == 0) return 0;
+			if (buffer.size() - tail < size)
+			{
+				size_t required = this->size() + size;
+				if (required > initialSize) lastLargeUse = std::chrono::steady_clock::now();
+				size_t newSize = std::max(required, buffer.size() * 2);
+				relocate(buffer.size() >= required ? buffer.size() : std::min(maxSize, newSize));
+			}
+			std::memcpy(buffer.data() + tail, src, size);
+			tail += size;
+			return size;
+		}
+
+		/* shrinks the buffer back to its initial size if it is empty and was not needed larger for the shrink delay.
+		 * Returns true if it was shrunk
+		 */
+		bool trim()
+		{
+			if (tail != 0 || buffer.size() <= initialSize) return false;
+			if (std::chrono::steady_clock::now() - lastLargeUse < shrinkDelay) return false;
+			std::vector<uint8_t>(initialSize).swap(buffer);
+			return true;
+		}
+	};
+}
+
+#endif //READRING_H
@@ -24,6 +24,8 @@
 #include  "spdlog/spdlog.h"
 
 #include <string>
+#include <deque>
+#include <algorithm>
 
 namespace rpcmple
 {
@@ -38,7 +40,13 @@ namespace rpcmple
 		dataSignature rets;
 
 		remoteProcedureSignature(std::wstring name, std::vector<char> arguments, std::vector<char> returns)
-			: procedureName(std::move(name)), args(std::move(arguments)), rets(std::move(returns)), id(0)
+			: id(0), procedureName(std::move(name)), args(std::move(arguments)), rets(std::move(returns))
+		{
+		};
+
+		template<typename... A, typename... R>
+		remoteProcedureSignature(std::wstring name, typedSignature<A...> arguments, typedSignature<R...> returns)
+			: remoteProcedureSignature(std::move(name), arguments.chars(), returns.chars())
 		{
 		};
 		virtual ~remoteProcedureSignature() = default;
@@ -49,14 +57,25 @@ namespace rpcmple
 		}
 	};
 
+	// procedureHandle identifies a remote procedure of an rpcClient, resolved once from its name
+	struct procedureHandle
+	{
+		static constexpr uint32_t invalidId = UINT32_MAX;
+		uint32_t id = invalidId;
+
+		bool valid() const { return id != invalidId; }
+	};
+
 	/* Class rpcClient implements messageManager for the rpc protocol.
-	 * Procedures must be added using the appendSignature method, in the same order as they are entered on the other process
+	 * Procedures must be added using the appendSignature method, in the same order as they are entered on the other process.
+	 * Calls by name look the name up in a hash table, calls through a procedureHandle do not look up anything
 	 */
 	class rpcClient : public messageManager
 	{
 	private:
 		std::vector<remoteProcedureSignature*> remoteProcedures;
-		std::map<std::wstring, uint32_t> remoteProceduresMap;
+		// open addressing table of procedure ids by name, with a power of two size at least twice the procedures
+		std::vector<uint32_t> procedureTable;
 
 		std::mutex mtx;
 		std::condition_variable cv;
@@ -74,50 +93,109 @@ namespace rpcmple
 
 		bool stopWait;
 
-	public:
-		explicit rpcClient(rpcmple::connectionManager::base* pConn)
-			: messageManager(pConn, true)
+		// calls waiting for their reply in duplex mode, in the order they were sent, see messageManager::enableDuplex
+		struct pendingCall
 		{
-			remoteProcedures.clear();
-			procedureID = 0;
-			canCall = true;
-			replIsReady = false;
-			sendIsReady = false;
-			callSuccessInt = 0;
-
-			sectionID = 0;
-			sectionLen = 4;
-
-			stopWait = false;
-		}
+			bool replied = false;
+			std::vector<uint8_t> rets;
+		};
+		std::deque<pendingCall*> pendingCalls;
+		// keeps calls queued in the same order as pendingCalls
+		std::mutex sendMtx;
 
-		~rpcClient() override
+		// stores the returns of the reply of the oldest call, and wakes up the thread waiting for it
+		bool replyReceived(const uint8_t* message, size_t size)
 		{
-			stopDataFlow();
-			for (auto& p : remoteProcedures)
 			{
-				delete p;
+				std::lock_guard<std::mutex> lock(mtx);
+				if (!duplexEnabled())
+				{
+					// copied, as the reply is decoded by the calling thread after parseMessage returns
+					rets.assign(message, message + size);
+					replIsReady = true;
+				}
+				else
+				{
+					if (pendingCalls.empty())
+					{
+						spdlog::error("rpcClient: reply received without a call");
+						return false;
+					}
+					pendingCalls.front()->rets.assign(message, message + size);
+					pendingCalls.front()->replied = true;
+					pendingCalls.pop_front();
+				}
 			}
-			remoteProcedures.clear();
-			remoteProceduresMap.clear();
+			cv.notify_all();
+			return true;
 		}
 
-		void appendSignature(remoteProcedureSignature* signature)
+		/* duplex version of doCallSync: the call is queued as soon as it is encoded, so that calls of several threads
+		 * are sent without waiting for the replies of the previous ones
+		 */
+		template<typename Encoder, typename Decoder>
+		bool doCallDuplex(uint32_t rpId, Encoder&& encode, Decoder&& decode)
 		{
-			signature->id = remoteProcedures.size();
-			remoteProcedures.push_back(signature);
-			remoteProceduresMap[signature->procedureName] = signature->id;
+			std::vector<uint8_t> message = acquireBuffer();
+			message.resize(frameHeaderSize);
+			if (!encode(message, frameHeaderSize))
+			{
+				spdlog::error("rpcClient: error translating variables to binary");
+				return false;
+			}
+			size_t bodySize = message.size() - frameHeaderSize;
+			if (bodySize > maxFrameBodySize)
+			{
+				spdlog::error("rpcClient: message size {} exceeding max allowed size {}", bodySize, maxFrameBodySize);
+				return false;
+			}
+			writeFrameHeader(rpId, bodySize, message.data());
+
+			pendingCall call;
+			{
+				std::lock_guard<std::mutex> sendLock(sendMtx);
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					if (stopWait) return false;
+					pendingCalls.push_back(&call);
+				}
+				// mtx is not held while posting, which can wait for the writer while replies are being parsed
+				if (!postMessage(std::move(message)))
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					pendingCalls.erase(std::find(pendingCalls.begin(), pendingCalls.end(), &call));
+					return false;
+				}
+			}
+
+			{
+				spdlog::debug("rpcClient: waiting for reply");
+				std::unique_lock<std::mutex> lock(mtx);
+				cv.wait(lock, [&] { return call.replied || this->stopWait; });
+				if (!call.replied)
+				{
+					pendingCalls.erase(std::find(pendingCalls.begin(), pendingCalls.end(), &call));
+					cv.notify_all();
+					return false;
+				}
+			}
+
+			cv.notify_all();
+			return decode(call.rets);
 		}
 
-		bool callSync(uint32_t rpId, variantVector& arguments, variantVector& returns)
+		// performs the call handshake with the data flow thread. encode serializes the arguments into the send buffer,
+		// decode deserializes the returns from the reply buffer
+		template<typename Encoder, typename Decoder>
+		bool doCallSync(uint32_t rpId, Encoder&& encode, Decoder&& decode)
 		{
-			auto* proc = remoteProcedures[rpId];
-
-			if (arguments.size() != proc->args.size())
+			// the frame flag of the call would read as compressed
+			if (rpId >= compressedFrameFlag && compressionEnabled())
 			{
-				spdlog::error("rpcClient: invalid number of arguments");
+				spdlog::error("rpcClient: procedure {} cannot be called with compression enabled", rpId);
 				return false;
 			}
+			if (duplexEnabled()) return doCallDuplex(rpId, encode, decode);
 
 			{
 				spdlog::debug("rpcClient: locking connection resources and waiting for rpc ready");
@@ -135,7 +213,7 @@ namespace rpcmple
 				spdlog::debug("rpcClient is locking resources and pushing new message");
 				std::lock_guard<std::mutex> stackLock(mtx);
 
-				if (!proc->args.toBinary(arguments, args))
+				if (!encode(args, 0))
 				{
 					spdlog::error("rpcClient: error translating variables to binary");
 					return false;
@@ -159,39 +237,215 @@ namespace rpcmple
 				replIsReady = false;
 				canCall = true;
 
-				if (!proc->rets.fromBinary(rets, returns))
+				if (!decode(rets))
 				{
-					spdlog::error("rpcClient: error translating variables to binary");
 					return false;
 				}
+			}
+			cv.notify_all();
 
-				if (returns.size() != proc->rets.size())
+			return true;
+		}
+
+		static size_t hashName(const std::wstring& name)
+		{
+			// FNV-1a
+			uint64_t hash = 14695981039346656037ULL;
+			for (wchar_t c : name)
+			{
+				hash = (hash ^ static_cast<uint64_t>(c)) * 1099511628211ULL;
+			}
+			return static_cast<size_t>(hash);
+		}
+
+		void rebuildProcedureTable()
+		{
+			size_t tableSize = 8;
+			while (tableSize < remoteProcedures.size() * 2) tableSize *= 2;
+			procedureTable.assign(tableSize, procedureHandle::invalidId);
+
+			// later procedures with a duplicate name replace earlier ones, as the name map did
+			for (remoteProcedureSignature* proc : remoteProcedures)
+			{
+				size_t slot = hashName(proc->procedureName) & (tableSize - 1);
+				while (procedureTable[slot] != procedureHandle::invalidId &&
+					remoteProcedures[procedureTable[slot]]->procedureName != proc->procedureName)
 				{
-					spdlog::error("rpcClient: invalid number of arguments");
-					return false;
+					slot = (slot + 1) & (tableSize - 1);
 				}
+				procedureTable[slot] = proc->id;
 			}
-			cv.notify_all();
+		}
 
-			return true;
+	public:
+		explicit rpcClient(rpcmple::connectionManager::base* pConn)
+			: messageManager(pConn, true)
+		{
+			remoteProcedures.clear();
+			rebuildProcedureTable();
+			procedureID = 0;
+			canCall = true;
+			replIsReady = false;
+			sendIsReady = false;
+			callSuccessInt = 0;
+
+			sectionID = 0;
+			sectionLen = 4;
+
+			stopWait = false;
 		}
 
-		bool callSync(std::wstring name, variantVector& arguments, variantVector& returns)
+		~rpcClient() override
 		{
-			if (remoteProceduresMap.count(name) == 0)
+			stopDataFlow();
+			for (auto& p : remoteProcedures)
 			{
-				spdlog::error("rpcClient: remote procedure name {} not found", "name");
+				delete p;
+			}
+			remoteProcedures.clear();
+			procedureTable.clear();
+		}
+
+		procedureHandle appendSignature(remoteProcedureSignature* signature)
+		{
+			signature->id = remoteProcedures.size();
+			if (signature->id >= compressedFrameFlag && compressionEnabled())
+			{
+				spdlog::warn("rpcClient: procedure {} cannot be called with compression enabled", signature->id);
+			}
+			remoteProcedures.push_back(signature);
+			rebuildProcedureTable();
+			return procedureHandle{signature->id};
+		}
+
+		uint32_t frameFlagCount() const override { return static_cast<uint32_t>(remoteProcedures.size()); }
+
+		// returns the handle of the procedure named name, which is not valid if no such procedure was appended
+		procedureHandle resolve(const std::wstring& name) const
+		{
+			size_t mask = procedureTable.size() - 1;
+			for (size_t slot = hashName(name) & mask; procedureTable[slot] != procedureHandle::invalidId;
+			     slot = (slot + 1) & mask)
+			{
+				if (remoteProcedures[procedureTable[slot]]->procedureName == name)
+				{
+					return procedureHandle{procedureTable[slot]};
+				}
+			}
+			return procedureHandle{};
+		}
+
+		// returns are decoded in place, reusing the strings and arrays returns holds from a previous call
+		bool callSync(uint32_t rpId, variantVector& arguments, variantVector& returns)
+		{
+			if (rpId >= remoteProcedures.size())
+			{
+				spdlog::error("rpcClient: invalid remote procedure ID {}", rpId);
 				return false;
 			}
-			uint32_t id = remoteProceduresMap[name];
+			auto* proc = remoteProcedures[rpId];
 
-			return callSync(id, arguments, returns);
+			if (arguments.size() != proc->args.fieldCount())
+			{
+				spdlog::error("rpcClient: invalid number of arguments");
+				return false;
+			}
+
+			return doCallSync(rpId, [&](std::vector<uint8_t>& message, size_t offset)
+			                  {
+				                  return proc->args.toBinary(arguments, message, offset);
+			                  },
+			                  [&](std::vector<uint8_t>& message)
+			                  {
+				                  if (!proc->rets.fromBinary(message, returns))
+				                  {
+					                  spdlog::error("rpcClient: error translating variables to binary");
+					                  return false;
+				                  }
+
+				                  if (returns.size() != proc->rets.fieldCount())
+				                  {
+					                  spdlog::error("rpcClient: invalid number of arguments");
+					                  return false;
+				                  }
+				                  return true;
+			                  });
+		}
+
+		// calls remote procedure with arguments and returns encoded through typedSignature<A...> and
+		// typedSignature<R...>, which must match the procedure signature
+		template<typename... A, typename... R>
+		bool callSync(uint32_t rpId, const std::tuple<A...>& arguments, std::tuple<R...>& returns)
+		{
+			if (rpId >= remoteProcedures.size())
+			{
+				spdlog::error("rpcClient: invalid remote procedure ID {}", rpId);
+				return false;
+			}
+			auto* proc = remoteProcedures[rpId];
+
+			if (!typedSignature<A...>::matches(proc->args) || !typedSignature<R...>::matches(proc->rets))
+			{
+				spdlog::error("rpcClient: typed arguments do not match remote procedure signature");
+				return false;
+			}
+
+			return doCallSync(rpId, [&](std::vector<uint8_t>& message, size_t offset)
+			                  {
+				                  return typedSignature<A...>::toBinary(arguments, message, offset);
+			                  },
+			                  [&](std::vector<uint8_t>& message)
+			                  {
+				                  if (!typedSignature<R...>::fromBinary(message, returns))
+				                  {
+					                  spdlog::error("rpcClient: error translating variables to binary");
+					                  return false;
+				                  }
+				                  return true;
+			                  });
+		}
+
+		bool callSync(procedureHandle procedure, variantVector& arguments, variantVector& returns)
+		{
+			return callSync(procedure.id, arguments, returns);
+		}
+
+		template<typename... A, typename... R>
+		bool callSync(procedureHandle procedure, const std::tuple<A...>& arguments, std::tuple<R...>& returns)
+		{
+			return callSync(procedure.id, arguments, returns);
+		}
+
+		bool callSync(const std::wstring& name, variantVector& arguments, variantVector& returns)
+		{
+			procedureHandle procedure = resolve(name);
+			if (!procedure.valid())
+			{
+				spdlog::error("rpcClient: remote procedure name {} not found", wstring_to_utf8(name));
+				return false;
+			}
+
+			return callSync(procedure.id, arguments, returns);
+		}
+
+		template<typename... A, typename... R>
+		bool callSync(const std::wstring& name, const std::tuple<A...>& arguments, std::tuple<R...>& returns)
+		{
+			procedureHandle procedure = resolve(name);
+			if (!procedure.valid())
+			{
+				spdlog::error("rpcClient: remote procedure name {} not found", wstring_to_utf8(name));
+				return false;
+			}
+
+			return callSync(procedure.id, arguments, returns);
 		}
 
 
 		bool writeMessage(std::vector<uint8_t>& message) override
 		{
-			if (sectionID != 0)
+			// in duplex mode calls are posted by the calling threads
+			if (sectionID != 0 || duplexEnabled())
 			{
 				message.resize(0);
 				return true;
@@ -214,21 +468,17 @@ namespace rpcmple
 				return false;
 			}
 
-			unsigned int offset = 0;
-
 			{
 				std::lock_guard<std::mutex> lock(mtx);
-				if (args.size() > 16777216)
+				if (args.size() > maxFrameBodySize)
 				{
-					spdlog::error("rpcClient: message size {} exceeding max allowed size 16777216", message.size());
+					spdlog::error("rpcClient: message size {} exceeding max allowed size {}", args.size(), maxFrameBodySize);
 					return false;
 				}
-				message.resize(offset + 4 + args.size());
-
-				uint32_t headerVal = procedureID * 16777216 + args.size();
-				uint32ToBytes(headerVal, message.data() + offset, true);
-				offset += 4;
-				std::copy(args.begin(), args.end(), message.data() + offset);
+				message.resize(frameHeaderSize);
+				writeFrameHeader(procedureID, args.size(), message.data());
+				// args is not changed until the reply is received, after the message is written
+				appendSegment(message, args.data(), args.size());
 
 				sendIsReady = false;
 			}
@@ -244,44 +494,31 @@ namespace rpcmple
 			return true;
 		}
 
-		bool parseMessage(std::vector<uint8_t> message) override
+		bool parseMessage(const uint8_t* message, size_t size) override
 		{
 			spdlog::debug("rpcClient: parsing message");
 			switch (sectionID)
 			{
 			case 0:
 				{
-					uint32_t mVal = bytesToUint32(message.data(), true);
-					callSuccessInt = mVal / 16777216;
-					sectionLen = mVal % 16777216;
+					readFrameHeader(message, &callSuccessInt, &sectionLen);
 					if (sectionLen > 0)
 					{
 						sectionID = 1;
 					}
 					else
 					{
-						{
-							std::lock_guard<std::mutex> lock(mtx);
-							rets.resize(0);
-							replIsReady = true;
-						}
+						if (!replyReceived(nullptr, 0)) return false;
 						sectionID = 0;
 						sectionLen = 4;
-						cv.notify_all();
 					}
 					break;
 				}
 			case 1:
 				{
-					{
-						std::lock_guard<std::mutex> lock(mtx);
-						rets.resize(message.size());
-						std::copy(message.begin(), message.end(), rets.data());
-						replIsReady = true;
-					}
+					if (!replyReceived(message, size)) return false;
 					sectionID = 0;
 					sectionLen = 4;
-					cv.notify_all();
 					break;
 				}
 			default:
@@ -310,6 +547,11 @@ namespace rpcmple
 			{
 				spdlog::debug("rpcClient: waiting until all calls are complete");
 				std::unique_lock<std::mutex> lock(mtx);
+				if (duplexEnabled())
+				{
+					cv.wait(lock, [this] { return this->pendingCalls.empty() || this->stopWait; });
+					return;
+				}
 				cv.wait(lock, [this] { return this->canCall || this->stopWait; });
 			}
 		}
@@ -42,7 +42,9 @@
  *   - 'w' for wstring (will be converted to UTF-8)
  *   - 'W' for array of wstring (will be converted to UTF-8)
  *   - 'u' for variant, which can be any of the above
- * Implementation requires to override called method, where the custom implementation of the procedure resides
+ * Implementation requires to override called method, where the custom implementation of the procedure resides,
+ * or to pass a function to the constructor. A function taking variantViewVector receives strings and arrays as views
+ * into the received message, avoiding their copy
  */
 
 namespace rpcmple
@@ -51,6 +53,11 @@ namespace rpcmple
 	{
 	private:
 		std::function<bool(variantVector&, variantVector&)> callFunction;
+		std::function<bool(const variantViewVector&, variantVector&)> viewCallFunction;
+		variantViewVector argumentViews;
+		// kept across calls, so that the strings and arrays of arguments are decoded in place
+		variantVector argumentValues;
+		variantVector returnValues;
 
 	public:
 		uint32_t id;
@@ -60,14 +67,22 @@ namespace rpcmple
 		dataSignature rets;
 
 		localProcedureSignature(std::wstring name, std::vector<char> arguments, std::vector<char> returns)
-			: procedureName(std::move(name)), args(std::move(arguments)), rets(std::move(returns)), id(0)
+			: id(0), procedureName(std::move(name)), args(std::move(arguments)), rets(std::move(returns))
 		{
 		}
 
 		localProcedureSignature(std::wstring name, std::vector<char> arguments, std::vector<char> returns,
 		                        std::function<bool(variantVector&, variantVector&)> function)
-			: procedureName(std::move(name)), args(std::move(arguments)), rets(std::move(returns)), id(0),
-			  callFunction(std::move(function))
+			: callFunction(std::move(function)), id(0), procedureName(std::move(name)), args(std::move(arguments)),
+			  rets(std::move(returns))
+		{
+		}
+
+		// function receives arguments as views into the received message, valid until the function returns
+		localProcedureSignature(std::wstring name, std::vector<char> arguments, std::vector<char> returns,
+		                        std::function<bool(const variantViewVector&, variantVector&)> function)
+			: viewCallFunction(std::move(function)), id(0), procedureName(std::move(name)),
+			  args(std::move(arguments)), rets(std::move(returns))
 		{
 		}
 
@@ -83,6 +98,92 @@ namespace rpcmple
 			              wstring_to_utf8(procedureName));
 			return false;
 		}
+
+		// invoke decodes the serialized arguments, executes the procedure and serializes its returns. message is valid
+		// until invoke returns. Default implementation goes through variantVector and the called method
+		virtual bool invoke(const uint8_t* message, size_t size, std::vector<uint8_t>& serializedReturns)
+		{
+			returnValues.clear();
+
+			if (viewCallFunction)
+			{
+				if (!args.fromBinaryView(message, size, argumentViews))
+				{
+					return false;
+				}
+				if (!viewCallFunction(argumentViews, returnValues))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (!args.fromBinary(message, size, argumentValues))
+				{
+					return false;
+				}
+				if (!called(argumentValues, returnValues))
+				{
+					return false;
+				}
+			}
+
+			if (returnValues.size() != rets.fieldCount())
+			{
+				serializedReturns.resize(0);
+				spdlog::error("rpcServer: procedure returned wrong number of variables");
+				return false;
+			}
+
+			if (!rets.toBinary(returnValues, serializedReturns))
+			{
+				serializedReturns.resize(0);
+				spdlog::error("rpcServer: procedure returned variables not matching its signature");
+				return false;
+			}
+			return true;
+		}
+	};
+
+	template<typename Arguments, typename Returns>
+	class typedLocalProcedureSignature;
+
+	/* Class typedLocalProcedureSignature is a localProcedureSignature whose arguments and returns are described by
+	 * typedSignature. The procedure receives std::tuple of arguments and fills std::tuple of returns, without going
+	 * through rpcmple::variant. Tuples are kept across calls, so that their strings and arrays are reused
+	 */
+	template<typename... A, typename... R>
+	class typedLocalProcedureSignature<typedSignature<A...>, typedSignature<R...>> : public localProcedureSignature
+	{
+	private:
+		std::function<bool(std::tuple<A...>&, std::tuple<R...>&)> typedFunction;
+
+		std::tuple<A...> arguments;
+		std::tuple<R...> returns;
+
+	public:
+		typedLocalProcedureSignature(std::wstring name,
+		                             std::function<bool(std::tuple<A...>&, std::tuple<R...>&)> function)
+			: localProcedureSignature(std::move(name), typedSignature<A...>::chars(), typedSignature<R...>::chars()),
+			  typedFunction(std::move(function))
+		{
+		}
+
+		bool invoke(const uint8_t* message, size_t size, std::vector<uint8_t>& serializedReturns) override
+		{
+			if (!typedSignature<A...>::fromBinary(message, size, arguments))
+			{
+				spdlog::error("rpcServer: error translating binary to arguments of {}", wstring_to_utf8(procedureName));
+				return false;
+			}
+
+			if (!typedFunction || !typedFunction(arguments, returns))
+			{
+				return false;
+			}
+
+			return typedSignature<R...>::toBinary(returns, serializedReturns);
+		}
 	};
 
 	/* Class rpcServer implements messageManager for the rpc protocol.
@@ -100,37 +201,27 @@ namespace rpcmple
 		uint32_t sectionLen;
 		uint16_t sectionID;
 
-		bool call(std::vector<uint8_t>& message)
+		bool call(const uint8_t* message, size_t size)
 		{
 			if (procedureID < localProcedures.size())
 			{
-				spdlog::debug("rpcServer: requested call to procedure {} {}", procedureID,
-				              wstring_to_utf8(localProcedures[procedureID]->procedureName));
-				localProcedureSignature* pProc = localProcedures[procedureID];
-
-				variantVector args(pProc->args.size());
-				pProc->args.fromBinary(message, args);
-
-				variantVector rets;
-				if (!pProc->called(args, rets))
+				// the name is converted only when it is logged
+				if (spdlog::should_log(spdlog::level::debug))
 				{
-					spdlog::error("Error calling RPC procedure {} {}", procedureID,
+					spdlog::debug("rpcServer: requested call to procedure {} {}", procedureID,
 					              wstring_to_utf8(localProcedures[procedureID]->procedureName));
-					return false;
 				}
+				localProcedureSignature* pProc = localProcedures[procedureID];
 
-				if (rets.size() != pProc->rets.size())
+				if (!pProc->invoke(message, size, callReturnsSerialized))
 				{
-					callReturnsSerialized.resize(0);
 					callSuccess = false;
-					spdlog::error("rpcServer: procedure returned wrong number of variables");
+					spdlog::error("Error calling RPC procedure {} {}", procedureID,
+					              wstring_to_utf8(localProcedures[procedureID]->procedureName));
 					return false;
 				}
 
 				callSuccess = true;
-				//callReturnsSerialized.resize(maxMessageSize);
-
-				pProc->rets.toBinary(rets, callReturnsSerialized);
 			}
 			else
 			{
@@ -167,28 +258,31 @@ namespace rpcmple
 		void appendSignature(localProcedureSignature* signature)
 		{
 			signature->id = localProcedures.size();
+			if (signature->id >= compressedFrameFlag && compressionEnabled())
+			{
+				spdlog::warn("rpcServer: procedure {} cannot be called with compression enabled", signature->id);
+			}
 			localProcedures.push_back(signature);
 		}
 
+		uint32_t frameFlagCount() const override { return static_cast<uint32_t>(localProcedures.size()); }
 
-		bool parseMessage(std::vector<uint8_t> message) override
+
+		bool parseMessage(const uint8_t* message, size_t size) override
 		{
 			spdlog::debug("rpcServer: parsing message");
 			switch (sectionID)
 			{
 			case 0:
 				{
-					uint32_t mVal = bytesToUint32(message.data(), true);
-					procedureID = mVal / 16777216;
-					sectionLen = mVal % 16777216;
+					readFrameHeader(message, &procedureID, &sectionLen);
 					if (sectionLen > 0)
 					{
 						sectionID = 1;
 					}
 					else
 					{
-						std::vector<uint8_t> noV(0);
-						if (!this->call(noV))
+						if (!this->call(nullptr, 0))
 						{
 							spdlog::error("rpcServer: error calling RPC procedure {} with 0 arguments", procedureID);
 							return false;
@@ -200,7 +294,7 @@ namespace rpcmple
 				}
 			case 1:
 				{
-					if (!this->call(message))
+					if (!this->call(message, size))
 					{
 						spdlog::error("rpcServer: error calling RPC procedure {}", procedureID);
 						return false;
@@ -228,26 +322,19 @@ namespace rpcmple
 				return true;
 			}
 
-			if (callReturnsSerialized.size() > 16777216)
+			if (callReturnsSerialized.size() > maxFrameBodySize)
 			{
-				spdlog::error("message size {} exceeding max allowed size 16777216", callReturnsSerialized.size());
+				spdlog::error("message size {} exceeding max allowed size {}", callReturnsSerialized.size(), maxFrameBodySize);
 				return false;
 			}
 
 			uint32_t callSuccessInt = 0;
 			if (callSuccess) callSuccessInt = 1;
 
-			retMessage.resize(4 + callReturnsSerialized.size());
-			unsigned int offset = 0;
-
-			uint32_t headerVal = callSuccessInt * 16777216 + callReturnsSerialized.size();
-			uint32ToBytes(headerVal, retMessage.data() + offset, true);
-			offset += 4;
-
-			std::copy(callReturnsSerialized.begin(), callReturnsSerialized.end(), retMessage.data() + offset);
-			offset += callReturnsSerialized.size();
-
-			retMessage.resize(offset);
+			retMessage.resize(frameHeaderSize);
+			writeFrameHeader(callSuccessInt, callReturnsSerialized.size(), retMessage.data());
+			// callReturnsSerialized is not changed until the next call, after the message is written
+			appendSegment(retMessage, callReturnsSerialized.data(), callReturnsSerialized.size());
 
 			return true;
 		}
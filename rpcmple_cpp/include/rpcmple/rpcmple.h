@@ -18,24 +18,40 @@
 
 #include <cstdint>
 #include <cstring>
+#include <type_traits>
 
 #include "spdlog/spdlog.h"
 
-#include <codecvt>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RPCMPLE_SSE2 1
+#endif
+
+// RPCMPLE_LITTLE_ENDIAN selects the host byte order at compile time. It can be defined before including rpcmple
+// on compilers which do not expose the byte order
+#ifndef RPCMPLE_LITTLE_ENDIAN
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define RPCMPLE_LITTLE_ENDIAN 1
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define RPCMPLE_LITTLE_ENDIAN 0
+#else
+#error "rpcmple: cannot detect host byte order, define RPCMPLE_LITTLE_ENDIAN to 1 or 0"
+#endif
+#endif
 
 namespace rpcmple
 {
-	// Function to convert std::wstring to UTF-8 encoded std::string
-	std::string wstring_to_utf8(const std::wstring& wstr)
-	{
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
-		return converter.to_bytes(wstr);
-	}
-
-	inline bool isMachineLittleEndian()
+	inline constexpr bool isMachineLittleEndian()
 	{
-		int num = 1;
-		return *(char*)&num == 1;
+		return RPCMPLE_LITTLE_ENDIAN;
 	}
 
 	inline uint64_t swapEndian64(uint64_t val)
@@ -57,6 +73,159 @@ namespace rpcmple
 		return (val << 8) | (val >> 8);
 	}
 
+	// swaps byte order of count elements of N bytes each from src to dst. src and dst can be the same buffer
+	template<size_t N>
+	inline void swapEndianArray(const uint8_t* src, size_t count, uint8_t* dst)
+	{
+		static_assert(N == 2 || N == 4 || N == 8, "unsupported element size");
+		size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+		// byte shuffle reversing each N byte group of a 16 byte lane
+		alignas(16) uint8_t shuffle[16];
+		for (int b = 0; b < 16; b++)
+		{
+			shuffle[b] = static_cast<uint8_t>((b / N) * N + (N - 1 - b % N));
+		}
+		const size_t elementsPerLane = 16 / N;
+		__m128i mask128 = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle));
+#if defined(__AVX2__)
+		__m256i mask256 = _mm256_broadcastsi128_si256(mask128);
+		for (; i + 2 * elementsPerLane <= count; i += 2 * elementsPerLane)
+		{
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * N));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * N), _mm256_shuffle_epi8(v, mask256));
+		}
+#endif
+		for (; i + elementsPerLane <= count; i += elementsPerLane)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * N));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * N), _mm_shuffle_epi8(v, mask128));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			if constexpr (N == 8)
+			{
+				uint64_t val;
+				std::memcpy(&val, src + i * N, N);
+				val = swapEndian64(val);
+				std::memcpy(dst + i * N, &val, N);
+			}
+			else if constexpr (N == 4)
+			{
+				uint32_t val;
+				std::memcpy(&val, src + i * N, N);
+				val = swapEndian32(val);
+				std::memcpy(dst + i * N, &val, N);
+			}
+			else
+			{
+				uint16_t val;
+				std::memcpy(&val, src + i * N, N);
+				val = swapEndian16(val);
+				std::memcpy(dst + i * N, &val, N);
+			}
+		}
+	}
+
+	// writes count numbers from src to dst as little endian bytes. It is a plain copy on little endian hosts
+	template<typename T>
+	inline void encodeArrayLE(const T* src, size_t count, uint8_t* dst)
+	{
+		static_assert(std::is_arithmetic<T>::value, "encodeArrayLE requires numeric elements");
+		if (count == 0) return;
+
+		if constexpr (isMachineLittleEndian() || sizeof(T) == 1)
+		{
+			std::memcpy(dst, src, count * sizeof(T));
+		}
+		else
+		{
+			swapEndianArray<sizeof(T)>(reinterpret_cast<const uint8_t*>(src), count, dst);
+		}
+	}
+
+	// reads count numbers stored as little endian bytes from src to dst. It is a plain copy on little endian hosts
+	template<typename T>
+	inline void decodeArrayLE(const uint8_t* src, size_t count, T* dst)
+	{
+		static_assert(std::is_arithmetic<T>::value, "decodeArrayLE requires numeric elements");
+		if (count == 0) return;
+
+		if constexpr (isMachineLittleEndian() || sizeof(T) == 1)
+		{
+			std::memcpy(dst, src, count * sizeof(T));
+		}
+		else
+		{
+			swapEndianArray<sizeof(T)>(src, count, reinterpret_cast<uint8_t*>(dst));
+		}
+	}
+
+	/* bool arrays are bit packed, 8 per byte, least significant bit first. src and dst can be any bool iterator, e.g.
+	 * of std::vector<bool>. Contiguous bool arrays are packed and unpacked 16 at a time with SSE2
+	 */
+	template<typename It>
+	inline void packBits(It src, size_t count, uint8_t* dst)
+	{
+		size_t i = 0;
+
+#if defined(RPCMPLE_SSE2)
+		if constexpr (std::is_pointer<It>::value)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				int bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+				dst[i / 8] = static_cast<uint8_t>(bits);
+				dst[i / 8 + 1] = static_cast<uint8_t>(bits >> 8);
+			}
+			src += i;
+		}
+#endif
+
+		for (; i < count; i += 8)
+		{
+			uint8_t byte = 0;
+			for (size_t b = 0; b < 8 && i + b < count; b++, ++src)
+			{
+				if (*src) byte |= 1 << b;
+			}
+			dst[i / 8] = byte;
+		}
+	}
+
+	template<typename It>
+	inline void unpackBits(const uint8_t* src, size_t count, It dst)
+	{
+		size_t i = 0;
+
+#if defined(RPCMPLE_SSE2)
+		if constexpr (std::is_pointer<It>::value)
+		{
+			const __m128i bitMask = _mm_set1_epi64x(0x8040201008040201LL);
+			const __m128i one = _mm_set1_epi8(1);
+			for (; i + 16 <= count; i += 16)
+			{
+				// broadcasts each of the 2 bytes to 8 lanes, then tests one bit per lane
+				__m128i v = _mm_set_epi64x(static_cast<long long>(src[i / 8 + 1] * 0x0101010101010101ULL),
+				                           static_cast<long long>(src[i / 8] * 0x0101010101010101ULL));
+				v = _mm_cmpeq_epi8(_mm_and_si128(v, bitMask), bitMask);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(v, one));
+			}
+			dst += i;
+		}
+#endif
+
+		for (; i < count; i++, ++dst)
+		{
+			*dst = (src[i / 8] >> (i % 8)) & 1;
+		}
+	}
+
 	inline void doubleToBytes(double dbl, uint8_t bytes[8], bool isLittleEndian)
 	{
 		uint64_t val;
@@ -190,6 +359,342 @@ namespace rpcmple
 		std::memcpy(&dbl, &val, sizeof dbl);
 		return dbl;
 	}
+
+	/* Compact integers are LEB128 varints: 7 bits per byte, least significant group first, high bit set on every byte
+	 * but the last. Signed integers are zigzag mapped first, so that small negative numbers stay short
+	 */
+	inline uint64_t zigzagEncode(int64_t val)
+	{
+		return (static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63);
+	}
+
+	inline int64_t zigzagDecode(uint64_t val)
+	{
+		return static_cast<int64_t>(val >> 1) ^ -static_cast<int64_t>(val & 1);
+	}
+
+	inline size_t varintSize(uint64_t val)
+	{
+		size_t size = 1;
+		while (val >= 0x80)
+		{
+			val >>= 7;
+			size++;
+		}
+		return size;
+	}
+
+	inline uint8_t* encodeVarint(uint64_t val, uint8_t* dst)
+	{
+		while (val >= 0x80)
+		{
+			*dst++ = static_cast<uint8_t>(val | 0x80);
+			val >>= 7;
+		}
+		*dst++ = static_cast<uint8_t>(val);
+		return dst;
+	}
+
+	// reads a varint at src[offset], advancing offset. Returns false if it is truncated or longer than 10 bytes
+	inline bool decodeVarint(const uint8_t* src, size_t size, size_t& offset, uint64_t* pVal)
+	{
+		uint64_t val = 0;
+		for (unsigned shift = 0; shift < 64 && offset < size; shift += 7)
+		{
+			uint8_t byte = src[offset++];
+			val |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (byte < 0x80)
+			{
+				*pVal = val;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* decodes count varints from src[offset] to dst, zigzag mapped when T is signed. Whenever the next 8 bytes hold
+	 * 8 single byte varints, which is the common case for small numbers, they are decoded at once
+	 */
+	template<typename T>
+	inline bool decodeVarintArray(const uint8_t* src, size_t size, size_t& offset, size_t count, T* dst)
+	{
+		static_assert(sizeof(T) == 8 && std::is_integral<T>::value, "decodeVarintArray requires 64 bit integers");
+		size_t i = 0;
+		while (i < count)
+		{
+			if (count - i >= 8 && size - offset >= 8)
+			{
+				uint64_t block;
+				std::memcpy(&block, src + offset, 8);
+				if ((block & 0x8080808080808080ULL) == 0)
+				{
+					for (size_t k = 0; k < 8; k++)
+					{
+						uint64_t byte = src[offset + k];
+						if constexpr (std::is_signed<T>::value) dst[i + k] = zigzagDecode(byte);
+						else dst[i + k] = byte;
+					}
+					offset += 8;
+					i += 8;
+					continue;
+				}
+			}
+
+			uint64_t val;
+			if (!decodeVarint(src, size, offset, &val)) return false;
+			if constexpr (std::is_signed<T>::value) dst[i++] = zigzagDecode(val);
+			else dst[i++] = val;
+		}
+		return true;
+	}
+
+	/* UTF-8 transcoding of wchar_t strings. wchar_t is taken as UTF-32 where it is 32 bit wide, and as UTF-16 where it
+	 * is 16 bit wide (Windows). Code points which cannot be represented are replaced by U+FFFD on encoding.
+	 * Runs of ASCII characters are converted 8 or 16 at a time when SSE2 is available
+	 */
+
+	// returns the number of leading ASCII characters in src
+	inline size_t asciiPrefixLength(const wchar_t* src, size_t count)
+	{
+		size_t i = 0;
+#ifdef RPCMPLE_SSE2
+		if constexpr (sizeof(wchar_t) == 4)
+		{
+			const __m128i highBits = _mm_set1_epi32(~0x7F);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+				__m128i high = _mm_and_si128(_mm_or_si128(a, b), highBits);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF) break;
+			}
+		}
+		else
+		{
+			const __m128i highBits = _mm_set1_epi16(~0x7F);
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+				__m128i high = _mm_and_si128(_mm_or_si128(a, b), highBits);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) break;
+			}
+		}
+#endif
+		while (i < count && static_cast<uint32_t>(src[i]) < 0x80) i++;
+		return i;
+	}
+
+	// reads the code point at src[i], advancing i. UTF-16 surrogate pairs are combined
+	inline uint32_t nextCodePoint(const wchar_t* src, size_t count, size_t& i)
+	{
+		auto cp = static_cast<uint32_t>(src[i++]);
+		if constexpr (sizeof(wchar_t) == 2)
+		{
+			if (cp >= 0xD800 && cp < 0xDC00 && i < count)
+			{
+				auto low = static_cast<uint32_t>(src[i]);
+				if (low >= 0xDC00 && low < 0xE000)
+				{
+					i++;
+					return 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				}
+			}
+		}
+		if ((cp >= 0xD800 && cp < 0xE000) || cp > 0x10FFFF) return 0xFFFD;
+		return cp;
+	}
+
+	// computes the length of the UTF-8 encoding of count wide characters, without converting them
+	inline size_t utf8Length(const wchar_t* src, size_t count)
+	{
+		size_t len = 0;
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t ascii = asciiPrefixLength(src + i, count - i);
+			len += ascii;
+			i += ascii;
+			if (i == count) break;
+
+			uint32_t cp = nextCodePoint(src, count, i);
+			if (cp < 0x800) len += 2;
+			else if (cp < 0x10000) len += 3;
+			else len += 4;
+		}
+		return len;
+	}
+
+	inline size_t utf8Length(const std::wstring& wstr)
+	{
+		return utf8Length(wstr.data(), wstr.size());
+	}
+
+	// writes the UTF-8 encoding of count wide characters to dst, which must hold utf8Length bytes.
+	// Returns the position after the last written byte
+	inline uint8_t* encodeUtf8(const wchar_t* src, size_t count, uint8_t* dst)
+	{
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t ascii = asciiPrefixLength(src + i, count - i);
+			size_t j = 0;
+#ifdef RPCMPLE_SSE2
+			if constexpr (sizeof(wchar_t) == 4)
+			{
+				for (; j + 8 <= ascii; j += 8)
+				{
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + j));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + j + 4));
+					__m128i narrow = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + j), narrow);
+				}
+			}
+			else
+			{
+				for (; j + 16 <= ascii; j += 16)
+				{
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + j));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + j + 8));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), _mm_packus_epi16(a, b));
+				}
+			}
+#endif
+			for (; j < ascii; j++)
+			{
+				dst[j] = static_cast<uint8_t>(src[i + j]);
+			}
+			dst += ascii;
+			i += ascii;
+			if (i == count) break;
+
+			uint32_t cp = nextCodePoint(src, count, i);
+			if (cp < 0x800)
+			{
+				*dst++ = static_cast<uint8_t>(0xC0 | (cp >> 6));
+				*dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+			}
+			else if (cp < 0x10000)
+			{
+				*dst++ = static_cast<uint8_t>(0xE0 | (cp >> 12));
+				*dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+				*dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+			}
+			else
+			{
+				*dst++ = static_cast<uint8_t>(0xF0 | (cp >> 18));
+				*dst++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+				*dst++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+				*dst++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+			}
+		}
+		return dst;
+	}
+
+	// decodes size bytes of UTF-8 from src to dst, reusing dst storage. Returns false if src is not valid UTF-8
+	inline bool decodeUtf8(const uint8_t* src, size_t size, std::wstring& dst)
+	{
+		// a wide string never has more characters than its UTF-8 encoding has bytes
+		dst.resize(size);
+		wchar_t* out = dst.data();
+		size_t i = 0;
+
+		while (i < size)
+		{
+#ifdef RPCMPLE_SSE2
+			while (i + 16 <= size)
+			{
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				if (_mm_movemask_epi8(bytes) != 0) break;
+
+				__m128i lo16 = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+				__m128i hi16 = _mm_unpackhi_epi8(bytes, _mm_setzero_si128());
+				if constexpr (sizeof(wchar_t) == 4)
+				{
+					__m128i* dst128 = reinterpret_cast<__m128i*>(out);
+					_mm_storeu_si128(dst128, _mm_unpacklo_epi16(lo16, _mm_setzero_si128()));
+					_mm_storeu_si128(dst128 + 1, _mm_unpackhi_epi16(lo16, _mm_setzero_si128()));
+					_mm_storeu_si128(dst128 + 2, _mm_unpacklo_epi16(hi16, _mm_setzero_si128()));
+					_mm_storeu_si128(dst128 + 3, _mm_unpackhi_epi16(hi16, _mm_setzero_si128()));
+				}
+				else
+				{
+					__m128i* dst128 = reinterpret_cast<__m128i*>(out);
+					_mm_storeu_si128(dst128, lo16);
+					_mm_storeu_si128(dst128 + 1, hi16);
+				}
+				out += 16;
+				i += 16;
+			}
+			if (i == size) break;
+#endif
+			uint8_t lead = src[i];
+			if (lead < 0x80)
+			{
+				*out++ = lead;
+				i++;
+				continue;
+			}
+
+			uint32_t cp;
+			size_t len;
+			uint32_t minCp;
+			if ((lead & 0xE0) == 0xC0)
+			{
+				cp = lead & 0x1F;
+				len = 2;
+				minCp = 0x80;
+			}
+			else if ((lead & 0xF0) == 0xE0)
+			{
+				cp = lead & 0x0F;
+				len = 3;
+				minCp = 0x800;
+			}
+			else if ((lead & 0xF8) == 0xF0)
+			{
+				cp = lead & 0x07;
+				len = 4;
+				minCp = 0x10000;
+			}
+			else
+			{
+				return false;
+			}
+
+			if (size - i < len) return false;
+			for (size_t k = 1; k < len; k++)
+			{
+				uint8_t cont = src[i + k];
+				if ((cont & 0xC0) != 0x80) return false;
+				cp = (cp << 6) | (cont & 0x3F);
+			}
+			if (cp < minCp || cp > 0x10FFFF || (cp >= 0xD800 && cp < 0xE000)) return false;
+			i += len;
+
+			if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+			{
+				cp -= 0x10000;
+				*out++ = static_cast<wchar_t>(0xD800 + (cp >> 10));
+				*out++ = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+			}
+			else
+			{
+				*out++ = static_cast<wchar_t>(cp);
+			}
+		}
+
+		dst.resize(out - dst.data());
+		return true;
+	}
+
+	// Function to convert std::wstring to UTF-8 encoded std::string
+	inline std::string wstring_to_utf8(const std::wstring& wstr)
+	{
+		std::string str(utf8Length(wstr), '\0');
+		encodeUtf8(wstr.data(), wstr.size(), reinterpret_cast<uint8_t*>(str.data()));
+		return str;
+	}
 }
 
 #endif //RPCMPLE_H
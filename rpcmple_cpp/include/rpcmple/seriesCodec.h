@@ -0,0 +1,557 @@
+// ******  rpcmple for c++ v0.2  ******
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+#include "dataSignature.h"
+#include "rpcmple.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace rpcmple
+{
+	// appends bits to a byte vector, most significant bit first
+	class bitWriter
+	{
+	private:
+		std::vector<uint8_t>& mOut;
+		uint64_t mAcc;
+		unsigned mBits;
+
+	public:
+		explicit bitWriter(std::vector<uint8_t>& out) : mOut(out), mAcc(0), mBits(0)
+		{
+		}
+
+		// writes the lowest bits of val, 1 to 64 bits
+		void write(uint64_t val, unsigned bits)
+		{
+			if (bits > 32)
+			{
+				write(val >> 32, bits - 32);
+				bits = 32;
+			}
+			mAcc = (mAcc << bits) | (val & ((uint64_t(1) << bits) - 1));
+			mBits += bits;
+			while (mBits >= 8)
+			{
+				mBits -= 8;
+				mOut.push_back(static_cast<uint8_t>(mAcc >> mBits));
+			}
+		}
+
+		// pads the last byte with zero bits
+		void flush()
+		{
+			if (mBits > 0)
+			{
+				mOut.push_back(static_cast<uint8_t>(mAcc << (8 - mBits)));
+				mBits = 0;
+			}
+		}
+	};
+
+	// reads bits written by bitWriter, failing instead of reading past the end
+	class bitReader
+	{
+	private:
+		const uint8_t* mData;
+		size_t mBitSize;
+		size_t mPos;
+
+	public:
+		bitReader(const uint8_t* data, size_t size) : mData(data), mBitSize(size * 8), mPos(0)
+		{
+		}
+
+		bool read(unsigned bits, uint64_t* pVal)
+		{
+			if (bits > mBitSize - mPos) return false;
+
+			uint64_t val = 0;
+			while (bits > 0)
+			{
+				unsigned avail = 8 - (mPos & 7);
+				unsigned take = avail < bits ? avail : bits;
+				uint64_t chunk = (mData[mPos >> 3] >> (avail - take)) & ((1u << take) - 1);
+				val = (val << take) | chunk;
+				mPos += take;
+				bits -= take;
+			}
+			*pVal = val;
+			return true;
+		}
+
+		size_t remaining() const
+		{
+			return mBitSize - mPos;
+		}
+	};
+
+	/* seriesCodec compresses a stream of records of a publisher / subscriber pair, in the style of the Gorilla time
+	 * series scheme: doubles are XORed with their previous value and only the meaningful bits are sent, integers are
+	 * sent as delta of delta in variable size buckets. It works on records already encoded by dataSignature, so it
+	 * supports signatures made of 'd', 'i', 'u' and of their arrays 'D', 'I', 'U', 'E', 'J', 'K' only.
+	 *
+	 * Frames start with a 32 bit sequence number. Keyframes carry the plain record and reset the state, delta frames
+	 * carry the bit packed differences to the previous record. A decoder which misses a frame drops delta frames until
+	 * the next keyframe, which the encoder emits every keyframeInterval records.
+	 */
+	class seriesCodec
+	{
+	public:
+		// header flags of series frames, in place of the 1 of plain published data
+		static constexpr uint32_t deltaFrameFlag = 2;
+		static constexpr uint32_t keyframeFlag = 3;
+
+	private:
+		static constexpr uint8_t noWindow = 0xFF;
+
+		struct valueState
+		{
+			uint64_t prev;
+			uint64_t prevDelta;
+			uint8_t leading;
+			uint8_t trailing;
+		};
+
+		struct fieldState
+		{
+			bool isDouble;
+			bool isArray;
+			bool wide;
+			std::vector<valueState> values;
+		};
+
+		std::vector<fieldState> fields;
+		uint32_t keyframeInterval;
+		uint32_t sinceKeyframe;
+		uint32_t sequence;
+		bool synced;
+		bool supported;
+
+		static unsigned leadingZeros(uint64_t val)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_clzll(val);
+#else
+			unsigned n = 0;
+			while (!(val & 0x8000000000000000ULL))
+			{
+				val <<= 1;
+				n++;
+			}
+			return n;
+#endif
+		}
+
+		static unsigned trailingZeros(uint64_t val)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(val);
+#else
+			unsigned n = 0;
+			while (!(val & 1))
+			{
+				val >>= 1;
+				n++;
+			}
+			return n;
+#endif
+		}
+
+		static void resetValue(valueState& state, uint64_t val)
+		{
+			state.prev = val;
+			state.prevDelta = 0;
+			state.leading = noWindow;
+			state.trailing = 0;
+		}
+
+		static void encodeValue(bitWriter& out, valueState& state, uint64_t val, bool isDouble)
+		{
+			if (isDouble)
+			{
+				uint64_t x = val ^ state.prev;
+				if (x == 0)
+				{
+					out.write(0, 1);
+				}
+				else
+				{
+					unsigned leading = leadingZeros(x);
+					unsigned trailing = trailingZeros(x);
+					if (state.leading != noWindow && state.leading <= leading && state.trailing <= trailing)
+					{
+						// '10': meaningful bits fit the previous window
+						out.write(2, 2);
+						out.write(x >> state.trailing, 64 - state.leading - state.trailing);
+					}
+					else
+					{
+						// '11': new window, 6 bit leading zeros and 6 bit meaningful bit count - 1
+						unsigned meaningful = 64 - leading - trailing;
+						out.write(3, 2);
+						out.write(leading, 6);
+						out.write(meaningful - 1, 6);
+						out.write(x >> trailing, meaningful);
+						state.leading = static_cast<uint8_t>(leading);
+						state.trailing = static_cast<uint8_t>(trailing);
+					}
+				}
+			}
+			else
+			{
+				uint64_t delta = val - state.prev;
+				uint64_t dod = zigzagEncode(static_cast<int64_t>(delta - state.prevDelta));
+				if (dod == 0)
+				{
+					out.write(0, 1);
+				}
+				else if (dod < 128)
+				{
+					out.write(2, 2);
+					out.write(dod, 7);
+				}
+				else if (dod < 512)
+				{
+					out.write(6, 3);
+					out.write(dod, 9);
+				}
+				else if (dod < 4096)
+				{
+					out.write(14, 4);
+					out.write(dod, 12);
+				}
+				else
+				{
+					out.write(15, 4);
+					out.write(dod, 64);
+				}
+				state.prevDelta = delta;
+			}
+			state.prev = val;
+		}
+
+		static bool decodeValue(bitReader& in, valueState& state, bool isDouble, uint64_t* pVal)
+		{
+			uint64_t bit;
+			if (!in.read(1, &bit)) return false;
+			if (bit == 0)
+			{
+				if (!isDouble) state.prev += state.prevDelta;
+				*pVal = state.prev;
+				return true;
+			}
+
+			if (isDouble)
+			{
+				if (!in.read(1, &bit)) return false;
+				if (bit == 1)
+				{
+					uint64_t leading, meaningful;
+					if (!in.read(6, &leading) || !in.read(6, &meaningful)) return false;
+					meaningful += 1;
+					if (leading + meaningful > 64) return false;
+					state.leading = static_cast<uint8_t>(leading);
+					state.trailing = static_cast<uint8_t>(64 - leading - meaningful);
+				}
+				else if (state.leading == noWindow)
+				{
+					return false;
+				}
+
+				uint64_t x;
+				if (!in.read(64 - state.leading - state.trailing, &x)) return false;
+				state.prev ^= x << state.trailing;
+			}
+			else
+			{
+				// bucket is selected by up to 3 more '1' bits after the first one
+				static constexpr unsigned bucketBits[] = {7, 9, 12, 64};
+				unsigned bucket = 0;
+				while (bucket < 3)
+				{
+					if (!in.read(1, &bit)) return false;
+					if (bit == 0) break;
+					bucket++;
+				}
+
+				uint64_t dod;
+				if (!in.read(bucketBits[bucket], &dod)) return false;
+				state.prevDelta += static_cast<uint64_t>(zigzagDecode(dod));
+				state.prev += state.prevDelta;
+			}
+			*pVal = state.prev;
+			return true;
+		}
+
+		// reads the length prefix of an array field of a plain record
+		static bool readArrayLength(const fieldState& field, const uint8_t* record, size_t size, size_t& offset,
+		                            size_t* pLength)
+		{
+			if (!readLength(record, size, offset, field.wide, pLength)) return false;
+			if ((size - offset) / 8 < *pLength)
+			{
+				spdlog::error("series codec: incomplete record");
+				return false;
+			}
+			return true;
+		}
+
+		// loads the state from a plain record, as carried by keyframes
+		bool loadRecord(const uint8_t* record, size_t size)
+		{
+			size_t offset = 0;
+			for (fieldState& field : fields)
+			{
+				size_t count = 1;
+				if (field.isArray && !readArrayLength(field, record, size, offset, &count)) return false;
+				if (!field.isArray && size - offset < 8)
+				{
+					spdlog::error("series codec: incomplete record");
+					return false;
+				}
+
+				field.values.resize(count);
+				for (valueState& state : field.values)
+				{
+					resetValue(state, bytesToUint64(record + offset, true));
+					offset += 8;
+				}
+			}
+			if (offset != size)
+			{
+				spdlog::error("series codec: record size mismatch");
+				return false;
+			}
+			return true;
+		}
+
+		bool encodeDelta(const uint8_t* record, size_t size, std::vector<uint8_t>& frame)
+		{
+			bitWriter out(frame);
+			size_t offset = 0;
+			for (fieldState& field : fields)
+			{
+				size_t count = 1;
+				if (field.isArray)
+				{
+					if (!readArrayLength(field, record, size, offset, &count)) return false;
+					if (count == field.values.size())
+					{
+						out.write(0, 1);
+					}
+					else
+					{
+						out.write(1, 1);
+						out.write(count, 32);
+						field.values.resize(count, valueState{0, 0, noWindow, 0});
+					}
+				}
+				else if (size - offset < 8)
+				{
+					spdlog::error("series codec: incomplete record");
+					return false;
+				}
+
+				for (valueState& state : field.values)
+				{
+					encodeValue(out, state, bytesToUint64(record + offset, true), field.isDouble);
+					offset += 8;
+				}
+			}
+			out.flush();
+			if (offset != size)
+			{
+				spdlog::error("series codec: record size mismatch");
+				return false;
+			}
+			return true;
+		}
+
+		bool decodeDelta(const uint8_t* data, size_t size, std::vector<uint8_t>& record)
+		{
+			bitReader in(data, size);
+			record.clear();
+			for (fieldState& field : fields)
+			{
+				if (field.isArray)
+				{
+					uint64_t changed;
+					if (!in.read(1, &changed)) return false;
+					if (changed)
+					{
+						uint64_t count;
+						if (!in.read(32, &count) || count > maxLength(field.wide)) return false;
+						// each value takes at least one bit, which bounds the count by the rest of the frame
+						if (count > in.remaining())
+						{
+							spdlog::error("series codec: array length exceeds the frame");
+							return false;
+						}
+						field.values.resize(count, valueState{0, 0, noWindow, 0});
+					}
+					size_t offset = record.size();
+					record.resize(offset + lengthSize(field.wide));
+					writeLength(field.values.size(), field.wide, record.data() + offset);
+				}
+
+				size_t offset = record.size();
+				record.resize(offset + field.values.size() * 8);
+				for (valueState& state : field.values)
+				{
+					uint64_t val;
+					if (!decodeValue(in, state, field.isDouble, &val)) return false;
+					uint64ToBytes(val, record.data() + offset, true);
+					offset += 8;
+				}
+			}
+			return true;
+		}
+
+	public:
+		explicit seriesCodec(const std::vector<char>& signature, uint32_t keyframeInterval = 64)
+			: keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1), sinceKeyframe(0), sequence(0),
+			  synced(false), supported(isSupported(signature))
+		{
+			for (char dataType : signature)
+			{
+				bool wide;
+				char baseType = dataSignature::narrowDataType(dataType, &wide);
+				fieldState field;
+				field.isDouble = baseType == 'd' || baseType == 'D';
+				field.isArray = baseType == 'D' || baseType == 'I' || baseType == 'U';
+				field.wide = wide;
+				field.values.resize(field.isArray ? 0 : 1);
+				fields.push_back(std::move(field));
+			}
+		}
+
+		static bool isSupported(const std::vector<char>& signature)
+		{
+			for (char dataType : signature)
+			{
+				switch (dataType)
+				{
+				case 'd':
+				case 'i':
+				case 'u':
+				case 'D':
+				case 'I':
+				case 'U':
+				case 'E':
+				case 'J':
+				case 'K':
+					break;
+				default:
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// forces the next encoded frame to be a keyframe, and the decoder to wait for one
+		void reset()
+		{
+			synced = false;
+		}
+
+		// compresses a plain record to frame, after the first offset bytes which are left untouched
+		bool encode(const uint8_t* record, size_t size, std::vector<uint8_t>& frame, size_t offset,
+		            uint32_t* pFlag)
+		{
+			if (!supported)
+			{
+				spdlog::error("series codec: unsupported signature");
+				return false;
+			}
+
+			frame.resize(offset + 4);
+			uint32ToBytes(sequence, frame.data() + offset, true);
+
+			if (!synced || sinceKeyframe >= keyframeInterval)
+			{
+				if (!loadRecord(record, size))
+				{
+					synced = false;
+					return false;
+				}
+				frame.insert(frame.end(), record, record + size);
+				*pFlag = keyframeFlag;
+				sinceKeyframe = 1;
+				synced = true;
+			}
+			else
+			{
+				if (!encodeDelta(record, size, frame))
+				{
+					synced = false;
+					return false;
+				}
+				*pFlag = deltaFrameFlag;
+				sinceKeyframe++;
+			}
+			sequence++;
+			return true;
+		}
+
+		/* decompresses a frame with header flag to the plain record. Returns false for malformed frames, and for delta
+		 * frames received while waiting for a keyframe, which are to be dropped
+		 */
+		bool decode(uint32_t flag, const uint8_t* frame, size_t size, std::vector<uint8_t>& record)
+		{
+			if (!supported)
+			{
+				spdlog::error("series codec: unsupported signature");
+				return false;
+			}
+			if (size < 4)
+			{
+				spdlog::error("series codec: incomplete frame");
+				return false;
+			}
+			uint32_t frameSequence = bytesToUint32(frame, true);
+
+			if (flag == keyframeFlag)
+			{
+				record.assign(frame + 4, frame + size);
+				synced = loadRecord(record.data(), record.size());
+				sequence = frameSequence;
+				return synced;
+			}
+
+			if (!synced || frameSequence != sequence + 1)
+			{
+				if (synced) spdlog::warn("series codec: frame {} lost, waiting for keyframe", sequence + 1);
+				synced = false;
+				return false;
+			}
+			if (!decodeDelta(frame + 4, size - 4, record))
+			{
+				spdlog::error("series codec: invalid delta frame, waiting for keyframe");
+				synced = false;
+				return false;
+			}
+			sequence = frameSequence;
+			return true;
+		}
+	};
+}
+
+#endif //SERIESCODEC_H
@@ -0,0 +1,392 @@
+// Copyright (C) 2024 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+/* Throughput benchmark of dataSignature encoding and decoding.
+ *
+ * rpcmple_bench_codec [--time ms] [--records n] [--random count] [--seed n]
+ *
+ * Without --random, benchmarks toBinary, fromBinary and fromBinaryView for each type code and for some mixed
+ * signatures, reporting ns/record, GB/s of encoded data and heap allocations/record. With --random, generates count
+ * random signatures with random values, checks that each one decodes to the data it was encoded from, and reports the
+ * signatures with the highest cost per encoded byte. Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+#include "rpcmple/rpcmple.h"
+#include "rpcmple/dataSignature.h"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::atomic<size_t> allocationCount{0};
+
+/* the replacements are not inlined: GCC would otherwise pair the malloc and free it sees inside them with the
+ * new and delete expressions of the callers and warn of mismatched allocation functions
+ */
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+BENCH_NOINLINE void* operator new(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size > 0 ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+struct benchResult {
+	double nsPerRecord;
+	double gbPerSecond;
+	double allocsPerRecord;
+};
+
+struct benchOptions {
+	int timeMs = 300;
+	size_t records = 256;
+	size_t randomCount = 0;
+	uint64_t seed = 1;
+	// array lengths and string sizes are drawn up to these limits
+	size_t maxArray = 16;
+	size_t maxString = 24;
+};
+
+static std::string randomString(std::mt19937_64& gen, size_t maxSize) {
+	std::string str(gen() % (maxSize + 1), ' ');
+	for (char& c : str) c = static_cast<char>('a' + gen() % 26);
+	return str;
+}
+
+static std::wstring randomWString(std::mt19937_64& gen, size_t maxSize) {
+	std::wstring str(gen() % (maxSize + 1), L' ');
+	for (wchar_t& c : str) c = static_cast<wchar_t>(L'a' + gen() % 26);
+	return str;
+}
+
+template<typename T>
+static std::vector<T> randomArray(std::mt19937_64& gen, size_t maxSize) {
+	std::vector<T> arr(gen() % (maxSize + 1));
+	for (size_t i = 0; i < arr.size(); i++) {
+		if constexpr (std::is_floating_point<T>::value) arr[i] = static_cast<T>(gen() % 100000) / 7;
+		else arr[i] = static_cast<T>(gen() % 1000);
+	}
+	return arr;
+}
+
+static rpcmple::recordField randomRecordField(char dataType, std::mt19937_64& gen, const benchOptions& opt) {
+	switch (dataType) {
+		case 'd': return static_cast<double>(gen() % 100000) / 7;
+		case 'f': return static_cast<float>(gen() % 100000) / 7;
+		case 'i':
+		case 'z': return static_cast<int64_t>(gen() % 2000) - 1000;
+		case 'u':
+		case 'q': return static_cast<uint64_t>(gen() % 1000);
+		case 'n': return static_cast<int32_t>(gen() % 1000);
+		case 'h': return static_cast<int16_t>(gen() % 1000);
+		case 'c': return static_cast<uint8_t>(gen());
+		case 'b': return gen() % 2 == 0;
+		case 'w': return randomWString(gen, opt.maxString);
+		default: return randomString(gen, opt.maxString);
+	}
+}
+
+// returns a random value for the field of signature starting at signature[*pPos], and moves *pPos past it
+static rpcmple::variant randomValue(const std::vector<char>& signature, size_t* pPos, std::mt19937_64& gen,
+                                    const benchOptions& opt) {
+	char dataType = signature[(*pPos)++];
+	switch (dataType) {
+		case 'd': return static_cast<double>(gen() % 100000) / 7;
+		case 'f': return static_cast<float>(gen() % 100000) / 7;
+		case 'i':
+		case 'z': return static_cast<int64_t>(gen() % 2000) - 1000;
+		case 'u':
+		case 'q': return static_cast<uint64_t>(gen() % 1000);
+		case 'n': return static_cast<int32_t>(gen() % 1000);
+		case 'h': return static_cast<int16_t>(gen() % 1000);
+		case 'c': return static_cast<uint8_t>(gen());
+		case 'b': return gen() % 2 == 0;
+		case 's':
+		case 'l': return randomString(gen, opt.maxString);
+		case 'w': return randomWString(gen, opt.maxString);
+		case 'D':
+		case 'E': return randomArray<double>(gen, opt.maxArray);
+		case 'F': return randomArray<float>(gen, opt.maxArray);
+		case 'I':
+		case 'J':
+		case 'Z': return randomArray<int64_t>(gen, opt.maxArray);
+		case 'U':
+		case 'K':
+		case 'Q': return randomArray<uint64_t>(gen, opt.maxArray);
+		case 'N': return randomArray<int32_t>(gen, opt.maxArray);
+		case 'H': return randomArray<int16_t>(gen, opt.maxArray);
+		case 'C':
+		case 'x': return randomArray<uint8_t>(gen, opt.maxArray * 8);
+		case 'B': {
+			std::vector<bool> arr(gen() % (opt.maxArray + 1));
+			for (size_t i = 0; i < arr.size(); i++) arr[i] = gen() % 2 == 0;
+			return arr;
+		}
+		case 'S':
+		case 'L': {
+			std::vector<std::string> arr(gen() % (opt.maxArray + 1));
+			for (std::string& str : arr) str = randomString(gen, opt.maxString);
+			return arr;
+		}
+		case 'W': {
+			std::vector<std::wstring> arr(gen() % (opt.maxArray + 1));
+			for (std::wstring& str : arr) str = randomWString(gen, opt.maxString);
+			return arr;
+		}
+		case 'v': {
+			static const std::vector<char> variantTypes = {'d', 'i', 'u', 's', 'D', 'I', 'S', 'x', 'f', 'b'};
+			size_t pos = 0;
+			std::vector<char> one = {variantTypes[gen() % variantTypes.size()]};
+			return randomValue(one, &pos, gen, opt);
+		}
+		case '[': {
+			std::vector<char> fieldTypes;
+			while (signature[*pPos] != ']') {
+				if (signature[*pPos] != '(' && signature[*pPos] != ')') fieldTypes.push_back(signature[*pPos]);
+				(*pPos)++;
+			}
+			(*pPos)++;
+			rpcmple::recordArray records(fieldTypes.size(), gen() % (opt.maxArray + 1));
+			for (size_t i = 0; i < records.size(); i++) {
+				for (size_t j = 0; j < fieldTypes.size(); j++) records[i][j] = randomRecordField(fieldTypes[j], gen, opt);
+			}
+			return records;
+		}
+		default: return int64_t(0);
+	}
+}
+
+static rpcmple::variantVector randomRecord(const std::vector<char>& signature, std::mt19937_64& gen,
+                                           const benchOptions& opt) {
+	rpcmple::variantVector record;
+	size_t pos = 0;
+	while (pos < signature.size()) {
+		if (signature[pos] == '(' || signature[pos] == ')') {
+			pos++;
+			continue;
+		}
+		record.push_back(randomValue(signature, &pos, gen, opt));
+	}
+	return record;
+}
+
+// runs op on every record, cycling through them until timeMs has elapsed
+template<typename Op>
+static benchResult runBench(size_t recordCount, size_t encodedBytes, int timeMs, Op op) {
+	using clock = std::chrono::steady_clock;
+	size_t iterations = 0;
+	size_t allocations = 0;
+	clock::duration elapsed{};
+	while (elapsed < std::chrono::milliseconds(timeMs)) {
+		size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		clock::time_point begin = clock::now();
+		for (size_t i = 0; i < recordCount; i++) op(i);
+		elapsed += clock::now() - begin;
+		allocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+		iterations++;
+	}
+
+	double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+	double records = static_cast<double>(iterations * recordCount);
+	return {ns / records, static_cast<double>(iterations * encodedBytes) / ns, allocations / records};
+}
+
+struct codecBench {
+	benchResult encode;
+	benchResult decode;
+	benchResult decodeView;
+	size_t bytesPerRecord;
+	bool roundTrip;
+};
+
+static bool benchSignature(const std::vector<char>& chars, const benchOptions& opt, std::mt19937_64& gen,
+                           codecBench* pResult) {
+	rpcmple::dataSignature signature(chars);
+	std::vector<rpcmple::variantVector> records(opt.records);
+	std::vector<std::vector<uint8_t>> messages(opt.records);
+	size_t encodedBytes = 0;
+	for (size_t i = 0; i < records.size(); i++) {
+		records[i] = randomRecord(chars, gen, opt);
+		if (!signature.toBinary(records[i], messages[i])) return false;
+		encodedBytes += messages[i].size();
+	}
+
+	// a decoded record encodes to the same bytes it was decoded from
+	pResult->roundTrip = true;
+	rpcmple::variantVector decoded;
+	std::vector<uint8_t> reencoded;
+	for (std::vector<uint8_t>& message : messages) {
+		if (!signature.fromBinary(message, decoded) || !signature.toBinary(decoded, reencoded) ||
+		    reencoded != message) {
+			pResult->roundTrip = false;
+		}
+	}
+
+	std::vector<uint8_t> buffer;
+	pResult->encode = runBench(records.size(), encodedBytes, opt.timeMs, [&](size_t i) {
+		signature.toBinary(records[i], buffer);
+	});
+	pResult->decode = runBench(records.size(), encodedBytes, opt.timeMs, [&](size_t i) {
+		signature.fromBinary(messages[i], decoded);
+	});
+	rpcmple::variantViewVector views;
+	pResult->decodeView = runBench(records.size(), encodedBytes, opt.timeMs, [&](size_t i) {
+		signature.fromBinaryView(messages[i].data(), messages[i].size(), views);
+	});
+	pResult->bytesPerRecord = encodedBytes / records.size();
+	return true;
+}
+
+static void printResult(const std::string& name, const char* op, const benchResult& result, size_t bytes) {
+	std::printf("%-24s %-12s %12.1f %10.3f %10.2f %10zu\n", name.c_str(), op, result.nsPerRecord, result.gbPerSecond,
+	            result.allocsPerRecord, bytes);
+}
+
+static std::vector<char> randomSignature(std::mt19937_64& gen) {
+	static const std::string types = "diusSwWDIUxfnhcbFNHCBzqZQvlLJKE";
+	static const std::string recordTypes = "diufnhcbzqslw";
+	std::vector<char> chars;
+	size_t fieldCount = 1 + gen() % 12;
+	for (size_t i = 0; i < fieldCount; i++) {
+		switch (gen() % 16) {
+			case 0: {
+				chars.push_back('[');
+				size_t recordSize = 1 + gen() % 4;
+				for (size_t j = 0; j < recordSize; j++) chars.push_back(recordTypes[gen() % recordTypes.size()]);
+				chars.push_back(']');
+				break;
+			}
+			case 1:
+				chars.push_back('(');
+				chars.push_back(types[gen() % types.size()]);
+				chars.push_back(types[gen() % types.size()]);
+				chars.push_back(')');
+				break;
+			default:
+				chars.push_back(types[gen() % types.size()]);
+		}
+	}
+	return chars;
+}
+
+static int runRandom(benchOptions opt) {
+	struct randomResult {
+		std::string signature;
+		codecBench bench;
+		double nsPerByte;
+	};
+
+	std::mt19937_64 gen(opt.seed);
+	std::vector<randomResult> results;
+	int failures = 0;
+	for (size_t i = 0; i < opt.randomCount; i++) {
+		std::vector<char> chars = randomSignature(gen);
+		std::string name(chars.begin(), chars.end());
+
+		// sizes vary per signature, to reach both tiny and large fields
+		opt.maxArray = size_t(1) << (gen() % 12);
+		opt.maxString = size_t(1) << (gen() % 10);
+
+		randomResult result{name, {}, 0};
+		if (!benchSignature(chars, opt, gen, &result.bench)) {
+			std::printf("FAIL encode %s (seed %llu)\n", name.c_str(), static_cast<unsigned long long>(opt.seed));
+			failures++;
+			continue;
+		}
+		if (!result.bench.roundTrip) {
+			std::printf("FAIL round trip %s (seed %llu)\n", name.c_str(), static_cast<unsigned long long>(opt.seed));
+			failures++;
+		}
+		// below 64 bytes the fixed cost of a call would rank first any signature of a few bytes
+		double cost = result.bench.encode.nsPerRecord + result.bench.decode.nsPerRecord;
+		result.nsPerByte = cost / std::max<size_t>(result.bench.bytesPerRecord, 64);
+		results.push_back(std::move(result));
+	}
+
+	std::sort(results.begin(), results.end(), [](const randomResult& a, const randomResult& b) {
+		return a.nsPerByte > b.nsPerByte;
+	});
+
+	std::printf("%zu random signatures, %d failures. Highest cost per encoded byte:\n", opt.randomCount, failures);
+	std::printf("%-24s %-12s %12s %10s %10s %10s\n", "signature", "op", "ns/record", "GB/s", "allocs", "bytes");
+	for (size_t i = 0; i < results.size() && i < 10; i++) {
+		const randomResult& result = results[i];
+		printResult(result.signature, "encode", result.bench.encode, result.bench.bytesPerRecord);
+		printResult(result.signature, "decode", result.bench.decode, result.bench.bytesPerRecord);
+		printResult(result.signature, "decodeView", result.bench.decodeView, result.bench.bytesPerRecord);
+	}
+	return failures > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+	spdlog::set_level(spdlog::level::warn);
+
+	benchOptions opt;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--time") == 0) opt.timeMs = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--records") == 0) opt.records = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "--random") == 0) opt.randomCount = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "--seed") == 0) opt.seed = std::strtoull(argv[i + 1], nullptr, 10);
+		else {
+			std::printf("usage: %s [--time ms] [--records n] [--random count] [--seed n]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (opt.randomCount > 0) return runRandom(opt);
+
+	const std::vector<std::string> signatures = {
+		"d", "D", "s", "S", "w", "W", "v", "i", "I", "x", "f", "F", "b", "B", "z", "Z",
+		// a market tick, a sensor sample, a log line and an order book snapshot
+		"dis", "ddddii", "uiss", "(id)DDII", "s[dd]",
+	};
+
+	std::mt19937_64 gen(opt.seed);
+	std::printf("%-24s %-12s %12s %10s %10s %10s\n", "signature", "op", "ns/record", "GB/s", "allocs", "bytes");
+	int failures = 0;
+	for (const std::string& name : signatures) {
+		std::vector<char> chars(name.begin(), name.end());
+		codecBench result{};
+		if (!benchSignature(chars, opt, gen, &result) || !result.roundTrip) {
+			std::printf("FAIL %s\n", name.c_str());
+			failures++;
+			continue;
+		}
+		printResult(name, "encode", result.encode, result.bytesPerRecord);
+		printResult(name, "decode", result.decode, result.bytesPerRecord);
+		printResult(name, "decodeView", result.decodeView, result.bytesPerRecord);
+	}
+	return failures > 0 ? 1 : 0;
+}
@@ -58,14 +58,14 @@ public:
 
 	bool called(std::vector<rpcmple::variant> &arguments, std::vector<rpcmple::variant> &returns) override {
 		spdlog::info("example1: rpc server received call to function sum");
-		std::vector<int64_t> intArrArg;
+		const std::vector<int64_t> *intArrArg;
 
 		int i = 0;
-		if (!rpcmple::getVariantValue(arguments[i++], &intArrArg)) return false;
+		if (!rpcmple::getVariantPtr(arguments[i++], &intArrArg)) return false;
 
 		int64_t retInt = 0;
-		for (auto j = 0; j < intArrArg.size(); j++) {
-			retInt += intArrArg[j];
+		for (auto j = 0; j < intArrArg->size(); j++) {
+			retInt += (*intArrArg)[j];
 		}
 
 		returns.emplace_back(retInt);
@@ -0,0 +1,132 @@
+// Copyright (C) 2025 Carlo Seghi. All rights reserved.
+// Author Carlo Seghi github.com/acs48.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the MIT license
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Library General Public License for more details.
+//
+// Use of this source code is governed by the MIT license
+// License that can be found in the LICENSE file.
+
+// Linux only: an rpc server and client pair on each of 9900 socket pairs, all served by two eventLoops
+
+#include "connectionmanager/base.h"
+#include "rpcmple/rpcmple.h"
+#include "rpcmple/rpcServer.h"
+#include "rpcmple/rpcClient.h"
+#include "rpcmple/eventLoop.h"
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv) {
+
+    auto console = spdlog::stdout_color_mt("rpcmple_cpp_example6");
+    spdlog::set_default_logger(console);
+    spdlog::set_level(spdlog::level::info);
+
+    const size_t connectionCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 9900;
+
+    // each connection takes two descriptors, one per side
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < connectionCount * 2 + 64) {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, connectionCount * 2 + 64);
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    rpcmple::eventLoop serverLoop(4);
+    rpcmple::eventLoop clientLoop(2);
+    if (!serverLoop.start() || !clientLoop.start()) return -1;
+
+    std::vector<std::unique_ptr<rpcmple::rpcServer>> servers;
+    std::vector<std::unique_ptr<rpcmple::rpcClient>> clients;
+    std::vector<rpcmple::procedureHandle> handles;
+    std::atomic<size_t> closedCount{0};
+
+    for (size_t i = 0; i < connectionCount; i++) {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            spdlog::error("cannot create socket pair {} of {}", i, connectionCount);
+            return -1;
+        }
+
+        servers.push_back(std::make_unique<rpcmple::rpcServer>(nullptr));
+        servers.back()->appendSignature(new rpcmple::localProcedureSignature(L"Repeat", {'i', 's'}, {'i', 's'},
+            [](rpcmple::variantVector &arguments, rpcmple::variantVector &returns) -> bool {
+            int64_t count = std::get<int64_t>(arguments[0]);
+            std::string repeated;
+            for (int64_t j = 0; j < count; j++) repeated += std::get<std::string>(arguments[1]);
+            returns.emplace_back(count);
+            returns.emplace_back(repeated);
+            return true;
+        }));
+
+        clients.push_back(std::make_unique<rpcmple::rpcClient>(nullptr));
+        handles.push_back(clients.back()->appendSignature(
+            new rpcmple::remoteProcedureSignature(L"Repeat", {'i', 's'}, {'i', 's'})));
+
+        // the repeated strings are compressed above 64 bytes
+        servers.back()->enableCompression(64);
+        clients.back()->enableCompression(64);
+
+        serverLoop.add(sockets[0], servers.back().get(), [&closedCount] { closedCount++; });
+        clientLoop.add(sockets[1], clients.back().get(), [&closedCount] { closedCount++; });
+    }
+    spdlog::info("{} connections served by two event loops", connectionCount);
+
+    std::atomic<size_t> callCount{0};
+    std::atomic<size_t> failCount{0};
+    auto call = [&](size_t i, int64_t count) {
+        rpcmple::variantVector arguments, returns;
+        arguments.emplace_back(count);
+        arguments.emplace_back(std::string("rpcmple "));
+        if (!clients[i]->callSync(handles[i], arguments, returns) ||
+            std::get<std::string>(returns[1]).size() != static_cast<size_t>(count) * 8) {
+            failCount++;
+        }
+        callCount++;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> callers;
+
+    // calls on every connection
+    for (size_t t = 0; t < 8; t++) {
+        callers.emplace_back([&, t] {
+            for (int round = 0; round < 5; round++)
+                for (size_t i = t; i < connectionCount; i += 8) call(i, static_cast<int64_t>(i % 50));
+        });
+    }
+
+    // duplex clients send the calls of several threads on one connection without waiting for the previous replies
+    for (size_t t = 0; t < 8; t++) {
+        callers.emplace_back([&] {
+            for (int k = 0; k < 2000; k++) call(0, 20);
+        });
+    }
+
+    for (auto& caller : callers) caller.join();
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("{} calls in {:.0f} ms, {} failed", callCount.load(), elapsed, failCount.load());
+
+    clientLoop.stop();
+    serverLoop.stop();
+    spdlog::info("{} connection ends notified", closedCount.load());
+
+    return failCount == 0 && closedCount == connectionCount * 2 ? 0 : -1;
+}
@@ -32,9 +32,227 @@ import (
 //   - 'D' for array of double
 //   - 's' for UTF-8 encoded string
 //   - 'S' for array of UTF-8 encoded string
-//   - 'u' for variant, which can be any of the above
+//   - 'x' for binary blob ([]byte)
+//   - 'z' for int64 as zigzag varint
+//   - 'Z' for array of int64 as zigzag varints
+//   - 'q' for uint64 as LEB128 varint
+//   - 'Q' for array of uint64 as LEB128 varints
+//   - 'f' for float32 and 'F' for array of float32
+//   - 'n' for int32 and 'N' for array of int32
+//   - 'h' for int16 and 'H' for array of int16
+//   - 'c' for uint8 and 'C' for array of uint8 ([]byte)
+//   - 'b' for bool and 'B' for array of bool, bit packed
+//   - 'v' for variant, which can be any of the above
+//
+// Strings and arrays are limited to 65535 bytes or elements. The following wide type codes carry the same data with
+// 32 bit lengths:
+//   - 'l' for UTF-8 encoded string
+//   - 'L' for array of UTF-8 encoded string
+//   - 'J' for array of int64
+//   - 'K' for array of uint64
+//   - 'E' for array of double
+//
+// A variant uses the wide type code only when its value exceeds 65535 bytes or elements.
 type DataSignature []byte
 
+// narrowTypes maps the type codes of narrow numbers and of their arrays to the Go type they are passed as.
+var narrowTypes = map[byte]reflect.Type{
+	'f': reflect.TypeOf(float32(0)),
+	'F': reflect.TypeOf([]float32{}),
+	'n': reflect.TypeOf(int32(0)),
+	'N': reflect.TypeOf([]int32{}),
+	'h': reflect.TypeOf(int16(0)),
+	'H': reflect.TypeOf([]int16{}),
+	'c': reflect.TypeOf(uint8(0)),
+	'C': reflect.TypeOf([]uint8{}),
+	'b': reflect.TypeOf(false),
+	'B': reflect.TypeOf([]bool{}),
+}
+
+// packBits packs bools 8 per byte, least significant bit first.
+func packBits(boolArr []bool) []byte {
+	packed := make([]byte, (len(boolArr)+7)/8)
+	for j, boolVal := range boolArr {
+		if boolVal {
+			packed[j/8] |= 1 << (j % 8)
+		}
+	}
+	return packed
+}
+
+// unpackBits reads count bools packed by packBits.
+func unpackBits(packed []byte, count int) []bool {
+	boolArr := make([]bool, count)
+	for j := range boolArr {
+		boolArr[j] = packed[j/8]>>(j%8)&1 != 0
+	}
+	return boolArr
+}
+
+// narrowDataType maps a wide type code to the base type code holding the same data, and reports whether it was wide.
+// 'x' has no base type code and is always wide.
+func narrowDataType(dataType byte) (byte, bool) {
+	switch dataType {
+	case 'l':
+		return 's', true
+	case 'L':
+		return 'S', true
+	case 'J':
+		return 'I', true
+	case 'K':
+		return 'U', true
+	case 'E':
+		return 'D', true
+	case 'x':
+		return 'x', true
+	}
+	return dataType, false
+}
+
+// wideDataType maps a base type code to its wide type code.
+func wideDataType(dataType byte) byte {
+	switch dataType {
+	case 's':
+		return 'l'
+	case 'S':
+		return 'L'
+	case 'I':
+		return 'J'
+	case 'U':
+		return 'K'
+	case 'D':
+		return 'E'
+	}
+	return dataType
+}
+
+// lengthSize returns the size of the length prefix of strings and arrays.
+func lengthSize(wide bool) int {
+	if wide {
+		return 4
+	}
+	return 2
+}
+
+// maxLength returns the largest string or array length which fits the length prefix.
+func maxLength(wide bool) uint64 {
+	if wide {
+		return 0xFFFFFFFF
+	}
+	return 65535
+}
+
+// writeLength writes a 16 bit, or 32 bit when wide, length prefix.
+func writeLength(body io.Writer, length int, wide bool) error {
+	if wide {
+		return binary.Write(body, binary.LittleEndian, uint32(length))
+	}
+	return binary.Write(body, binary.LittleEndian, uint16(length))
+}
+
+// readLength reads a 16 bit, or 32 bit when wide, length prefix. When the reader knows how many bytes are left, a
+// length which cannot fit them with at least elemSize bytes per element is rejected before anything is allocated.
+func readLength(mr io.Reader, wide bool, elemSize int) (int, error) {
+	var length int
+	if wide {
+		var wideLen uint32
+		if err := binary.Read(mr, binary.LittleEndian, &wideLen); err != nil {
+			return 0, err
+		}
+		length = int(wideLen)
+	} else {
+		var shortLen uint16
+		if err := binary.Read(mr, binary.LittleEndian, &shortLen); err != nil {
+			return 0, err
+		}
+		length = int(shortLen)
+	}
+	if lr, ok := mr.(interface{ Len() int }); ok && uint64(length)*uint64(elemSize) > uint64(lr.Len()) {
+		return 0, io.ErrUnexpectedEOF
+	}
+	return length, nil
+}
+
+// CompactIntegers returns a copy of the signature with every 'i', 'u', 'I', 'U' replaced by its compact integer type
+// code 'z', 'q', 'Z', 'Q'. Both sides must use the compact signature.
+func (ds DataSignature) CompactIntegers() DataSignature {
+	compact := make(DataSignature, len(ds))
+	for i, dataType := range ds {
+		switch dataType {
+		case 'i':
+			dataType = 'z'
+		case 'u':
+			dataType = 'q'
+		case 'I':
+			dataType = 'Z'
+		case 'U':
+			dataType = 'Q'
+		}
+		compact[i] = dataType
+	}
+	return compact
+}
+
+// writeUvarint writes a LEB128 varint.
+func writeUvarint(body io.Writer, val uint64) error {
+	var buf [binary.MaxVarintLen64]byte
+	n := binary.PutUvarint(buf[:], val)
+	_, err := body.Write(buf[:n])
+	return err
+}
+
+// readUvarint reads a LEB128 varint.
+func readUvarint(mr io.Reader) (uint64, error) {
+	if br, ok := mr.(io.ByteReader); ok {
+		return binary.ReadUvarint(br)
+	}
+	var val uint64
+	var buf [1]byte
+	for shift := 0; shift < 64; shift += 7 {
+		if _, err := io.ReadFull(mr, buf[:]); err != nil {
+			return 0, err
+		}
+		val |= uint64(buf[0]&0x7F) << shift
+		if buf[0] < 0x80 {
+			return val, nil
+		}
+	}
+	return 0, io.ErrUnexpectedEOF
+}
+
+// zigzagEncode maps signed integers to unsigned ones so that small negative numbers stay short.
+func zigzagEncode(val int64) uint64 {
+	return uint64(val<<1) ^ uint64(val>>63)
+}
+
+func zigzagDecode(val uint64) int64 {
+	return int64(val>>1) ^ -int64(val&1)
+}
+
+// needsWide reports whether a variant value exceeds the 16 bit length prefixes.
+func needsWide(v reflect.Value) bool {
+	switch val := v.Interface().(type) {
+	case string:
+		return len(val) > 65535
+	case []float64:
+		return len(val) > 65535
+	case []int64:
+		return len(val) > 65535
+	case []uint64:
+		return len(val) > 65535
+	case []string:
+		if len(val) > 65535 {
+			return true
+		}
+		for _, strVal := range val {
+			if len(strVal) > 65535 {
+				return true
+			}
+		}
+	}
+	return false
+}
+
 // ToBinary serializes the provided arguments to binary format and writes them to the given io.Writer based on the DataSignature.
 // Returns true if serialization is successful, false otherwise.
 func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
@@ -66,10 +284,33 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 				arg = 's'
 			case reflect.TypeOf([]string{}):
 				arg = 'S'
+			case reflect.TypeOf([]byte{}):
+				arg = 'x'
+			case reflect.TypeOf(float32(1.)):
+				arg = 'f'
+			case reflect.TypeOf([]float32{}):
+				arg = 'F'
+			case reflect.TypeOf(int32(1)):
+				arg = 'n'
+			case reflect.TypeOf([]int32{}):
+				arg = 'N'
+			case reflect.TypeOf(int16(1)):
+				arg = 'h'
+			case reflect.TypeOf([]int16{}):
+				arg = 'H'
+			case reflect.TypeOf(uint8(1)):
+				arg = 'c'
+			case reflect.TypeOf(false):
+				arg = 'b'
+			case reflect.TypeOf([]bool{}):
+				arg = 'B'
 			default:
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("invalid signature serializing variant data: %v\n", arg)
 				return false
 			}
+			if needsWide(v) {
+				arg = wideDataType(arg)
+			}
 			err := binary.Write(body, binary.LittleEndian, arg)
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", arg, err)
@@ -77,6 +318,8 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 			}
 		}
 
+		arg, wide := narrowDataType(arg)
+
 		switch arg {
 		case 'd': // double
 			if t != reflect.TypeOf(float64(1.)) {
@@ -95,14 +338,13 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 				return false
 			}
 			dblArrVal := v.Interface().([]float64)
-			if len(dblArrVal) > 65536 {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of doubles too long, max 65536 elements\n")
+			if uint64(len(dblArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of doubles too long, max %d elements\n", maxLength(wide))
 				return false
 			}
-			arrLen := uint16(len(dblArrVal))
-			err := binary.Write(body, binary.LittleEndian, arrLen)
+			err := writeLength(body, len(dblArrVal), wide)
 			if err != nil {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", arrLen, err)
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(dblArrVal), err)
 				return false
 			}
 			err = binary.Write(body, binary.LittleEndian, dblArrVal)
@@ -127,14 +369,13 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 				return false
 			}
 			intArrVal := v.Interface().([]int64)
-			if len(intArrVal) > 65536 {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of ints too long, max 65536 elements\n")
+			if uint64(len(intArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of ints too long, max %d elements\n", maxLength(wide))
 				return false
 			}
-			arrLen := uint16(len(intArrVal))
-			err := binary.Write(body, binary.LittleEndian, arrLen)
+			err := writeLength(body, len(intArrVal), wide)
 			if err != nil {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", arrLen, err)
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(intArrVal), err)
 				return false
 			}
 			err = binary.Write(body, binary.LittleEndian, intArrVal)
@@ -159,14 +400,13 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 				return false
 			}
 			uintArrVal := v.Interface().([]uint64)
-			if len(uintArrVal) > 65536 {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of uints too long, max 65536 elements\n")
+			if uint64(len(uintArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of uints too long, max %d elements\n", maxLength(wide))
 				return false
 			}
-			arrLen := uint16(len(uintArrVal))
-			err := binary.Write(body, binary.LittleEndian, arrLen)
+			err := writeLength(body, len(uintArrVal), wide)
 			if err != nil {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", arrLen, err)
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(uintArrVal), err)
 				return false
 			}
 			err = binary.Write(body, binary.LittleEndian, uintArrVal)
@@ -182,14 +422,13 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 				return false
 			}
 			strVal := v.String()
-			if len(strVal) > 65536 {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("string too long, max 65536 elements\n")
+			if uint64(len(strVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("string too long, max %d bytes\n", maxLength(wide))
 				return false
 			}
-			strLen := uint16(len(strVal))
-			err := binary.Write(body, binary.LittleEndian, strLen)
+			err := writeLength(body, len(strVal), wide)
 			if err != nil {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", strLen, err)
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(strVal), err)
 				return false
 			}
 			err = binary.Write(body, binary.LittleEndian, []byte(strVal))
@@ -206,26 +445,24 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 			}
 
 			strArrVal := v.Interface().([]string)
-			if len(strArrVal) > 65536 {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of strings too long, max 65536 elements\n")
+			if uint64(len(strArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of strings too long, max %d elements\n", maxLength(wide))
 				return false
 			}
-			strArrLen := uint16(len(strArrVal))
-			err := binary.Write(body, binary.LittleEndian, strArrLen)
+			err := writeLength(body, len(strArrVal), wide)
 			if err != nil {
-				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", strArrLen, err)
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(strArrVal), err)
 				return false
 			}
 
 			for _, strVal := range strArrVal {
-				if len(strVal) > 65536 {
-					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("string too long, max 65536 elements\n")
+				if uint64(len(strVal)) > maxLength(wide) {
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("string too long, max %d bytes\n", maxLength(wide))
 					return false
 				}
-				strLen := uint16(len(strVal))
-				err := binary.Write(body, binary.LittleEndian, strLen)
+				err := writeLength(body, len(strVal), wide)
 				if err != nil {
-					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", strLen, err)
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(strVal), err)
 					return false
 				}
 				err = binary.Write(body, binary.LittleEndian, []byte(strVal))
@@ -234,6 +471,141 @@ func (ds DataSignature) ToBinary(body io.Writer, arguments ...any) bool {
 					return false
 				}
 			}
+		case 'z': // compact int
+			if t != reflect.TypeOf(int64(1)) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", reflect.TypeOf(int64(1)), t)
+				return false
+			}
+			intVal := v.Int()
+			err := writeUvarint(body, zigzagEncode(intVal))
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", intVal, err)
+				return false
+			}
+		case 'Z': // array of compact int
+			if t != reflect.TypeOf([]int64{}) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", reflect.TypeOf([]int64{}), t)
+				return false
+			}
+			intArrVal := v.Interface().([]int64)
+			if uint64(len(intArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of ints too long, max %d elements\n", maxLength(wide))
+				return false
+			}
+			err := writeLength(body, len(intArrVal), wide)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(intArrVal), err)
+				return false
+			}
+			for _, intVal := range intArrVal {
+				err = writeUvarint(body, zigzagEncode(intVal))
+				if err != nil {
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", intVal, err)
+					return false
+				}
+			}
+		case 'q': // compact uint
+			if t != reflect.TypeOf(uint64(1)) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", reflect.TypeOf(uint64(1)), t)
+				return false
+			}
+			uintVal := v.Uint()
+			err := writeUvarint(body, uintVal)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", uintVal, err)
+				return false
+			}
+		case 'Q': // array of compact uint
+			if t != reflect.TypeOf([]uint64{}) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", reflect.TypeOf([]uint64{}), t)
+				return false
+			}
+			uintArrVal := v.Interface().([]uint64)
+			if uint64(len(uintArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of uints too long, max %d elements\n", maxLength(wide))
+				return false
+			}
+			err := writeLength(body, len(uintArrVal), wide)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(uintArrVal), err)
+				return false
+			}
+			for _, uintVal := range uintArrVal {
+				err = writeUvarint(body, uintVal)
+				if err != nil {
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", uintVal, err)
+					return false
+				}
+			}
+		case 'x': // binary blob
+			if t != reflect.TypeOf([]byte{}) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", reflect.TypeOf([]byte{}), t)
+				return false
+			}
+			blobVal := v.Bytes()
+			if uint64(len(blobVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("binary blob too long, max %d bytes\n", maxLength(wide))
+				return false
+			}
+			err := writeLength(body, len(blobVal), wide)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(blobVal), err)
+				return false
+			}
+			_, err = body.Write(blobVal)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", blobVal, err)
+				return false
+			}
+		case 'f', 'n', 'h', 'c', 'b': // narrow number
+			if t != narrowTypes[arg] {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", narrowTypes[arg], t)
+				return false
+			}
+			err := binary.Write(body, binary.LittleEndian, v.Interface())
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", v.Interface(), err)
+				return false
+			}
+		case 'F', 'N', 'H', 'C': // array of narrow numbers
+			if t != narrowTypes[arg] {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", narrowTypes[arg], t)
+				return false
+			}
+			if uint64(v.Len()) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of numbers too long, max %d elements\n", maxLength(wide))
+				return false
+			}
+			err := writeLength(body, v.Len(), wide)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", v.Len(), err)
+				return false
+			}
+			err = binary.Write(body, binary.LittleEndian, v.Interface())
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", v.Interface(), err)
+				return false
+			}
+		case 'B': // array of bools
+			if t != narrowTypes[arg] {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("wrong argument passed to rpc call, expected %v, got %v\n", narrowTypes[arg], t)
+				return false
+			}
+			boolArrVal := v.Interface().([]bool)
+			if uint64(len(boolArrVal)) > maxLength(wide) {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("array of bools too long, max %d elements\n", maxLength(wide))
+				return false
+			}
+			err := writeLength(body, len(boolArrVal), wide)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", len(boolArrVal), err)
+				return false
+			}
+			_, err = body.Write(packBits(boolArrVal))
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not serialize argument: %v: %v\n", boolArrVal, err)
+				return false
+			}
 		default:
 			log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("invalid signature serializing data: %v\n", arg)
 			return false
@@ -262,7 +634,9 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", byteVal, err)
 				return false
 			}
-			if byteVal == 'd' || byteVal == 'D' || byteVal == 'i' || byteVal == 'I' || byteVal == 'u' || byteVal == 'U' || byteVal == 's' || byteVal == 'S' || byteVal == 'w' || byteVal == 'W' {
+			if byteVal == 'd' || byteVal == 'D' || byteVal == 'i' || byteVal == 'I' || byteVal == 'u' || byteVal == 'U' || byteVal == 's' || byteVal == 'S' || byteVal == 'w' || byteVal == 'W' ||
+				byteVal == 'l' || byteVal == 'L' || byteVal == 'J' || byteVal == 'K' || byteVal == 'E' || byteVal == 'x' ||
+				narrowTypes[byteVal] != nil {
 				ret = byteVal
 			} else {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("invalid signature deserializing variant type: %v\n", ret)
@@ -270,6 +644,8 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 			}
 		}
 
+		ret, wide := narrowDataType(ret)
+
 		switch ret {
 		case 'd':
 			dblVal := float64(1.)
@@ -280,8 +656,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 			}
 			(*callbackValues)[i] = dblVal
 		case 'D':
-			var dblArrLen uint16
-			err = binary.Read(mr, binary.LittleEndian, &dblArrLen)
+			dblArrLen, err := readLength(mr, wide, 8)
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", dblArrLen, err)
 				return false
@@ -302,8 +677,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 			}
 			(*callbackValues)[i] = intVal
 		case 'I':
-			var intArrLen uint16
-			err = binary.Read(mr, binary.LittleEndian, &intArrLen)
+			intArrLen, err := readLength(mr, wide, 8)
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", intArrLen, err)
 				return false
@@ -324,8 +698,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 			}
 			(*callbackValues)[i] = uintVal
 		case 'U':
-			var uintArrLen uint16
-			err = binary.Read(mr, binary.LittleEndian, &uintArrLen)
+			uintArrLen, err := readLength(mr, wide, 8)
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintArrLen, err)
 				return false
@@ -340,8 +713,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 		case 'w':
 			fallthrough
 		case 's':
-			var strLen uint16
-			err = binary.Read(mr, binary.LittleEndian, &strLen)
+			strLen, err := readLength(mr, wide, 1)
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", strLen, err)
 				return false
@@ -358,8 +730,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 		case 'W':
 			fallthrough
 		case 'S':
-			var strArrLen uint16
-			err = binary.Read(mr, binary.LittleEndian, &strArrLen)
+			strArrLen, err := readLength(mr, wide, lengthSize(wide))
 			if err != nil {
 				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", strArrLen, err)
 				return false
@@ -368,8 +739,7 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 			strArr := make([]string, strArrLen)
 
 			for j := range strArr {
-				var strLen uint16
-				err = binary.Read(mr, binary.LittleEndian, &strLen)
+				strLen, err := readLength(mr, wide, 1)
 				if err != nil {
 					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", strLen, err)
 					return false
@@ -385,6 +755,100 @@ func (ds DataSignature) FromBinary(mr io.Reader, callbackValues *[]any) bool {
 				strArr[j] = str
 			}
 			(*callbackValues)[i] = strArr
+		case 'z':
+			uintVal, err := readUvarint(mr)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintVal, err)
+				return false
+			}
+			(*callbackValues)[i] = zigzagDecode(uintVal)
+		case 'Z':
+			intArrLen, err := readLength(mr, wide, 1)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", intArrLen, err)
+				return false
+			}
+			intArr := make([]int64, intArrLen)
+			for j := range intArr {
+				uintVal, err := readUvarint(mr)
+				if err != nil {
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintVal, err)
+					return false
+				}
+				intArr[j] = zigzagDecode(uintVal)
+			}
+			(*callbackValues)[i] = intArr
+		case 'q':
+			uintVal, err := readUvarint(mr)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintVal, err)
+				return false
+			}
+			(*callbackValues)[i] = uintVal
+		case 'Q':
+			uintArrLen, err := readLength(mr, wide, 1)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintArrLen, err)
+				return false
+			}
+			uintArr := make([]uint64, uintArrLen)
+			for j := range uintArr {
+				uintArr[j], err = readUvarint(mr)
+				if err != nil {
+					log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", uintArr[j], err)
+					return false
+				}
+			}
+			(*callbackValues)[i] = uintArr
+		case 'x':
+			blobLen, err := readLength(mr, wide, 1)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", blobLen, err)
+				return false
+			}
+
+			blob := make([]byte, blobLen)
+			_, err = io.ReadFull(mr, blob)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", blob, err)
+				return false
+			}
+			(*callbackValues)[i] = blob
+		case 'f', 'n', 'h', 'c', 'b':
+			val := reflect.New(narrowTypes[ret])
+			err = binary.Read(mr, binary.LittleEndian, val.Interface())
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", ret, err)
+				return false
+			}
+			(*callbackValues)[i] = val.Elem().Interface()
+		case 'F', 'N', 'H', 'C':
+			arrType := narrowTypes[ret]
+			arrLen, err := readLength(mr, wide, int(arrType.Elem().Size()))
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", arrLen, err)
+				return false
+			}
+			arr := reflect.MakeSlice(arrType, arrLen, arrLen)
+			err = binary.Read(mr, binary.LittleEndian, arr.Interface())
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", arrLen, err)
+				return false
+			}
+			(*callbackValues)[i] = arr.Interface()
+		case 'B':
+			boolArrLen, err := readLength(mr, wide, 0)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", boolArrLen, err)
+				return false
+			}
+			packed := make([]byte, (boolArrLen+7)/8)
+			_, err = io.ReadFull(mr, packed)
+			if err != nil {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("could not deserialize argument: %v: %v\n", boolArrLen, err)
+				return false
+			}
+			(*callbackValues)[i] = unpackBits(packed, boolArrLen)
 		default:
 			log.WithFields(log.Fields{"app": "rpcmple_go", "func": "signature"}).Errorf("invalid signature deserializing data: %v\n", ret)
 			return false
@@ -20,6 +20,7 @@ import (
 	"encoding/binary"
 	log "github.com/sirupsen/logrus"
 	"io"
+	"time"
 )
 
 // MessageParser provides an interface for parsing, sending, and managing messages. An implementation
@@ -59,6 +60,10 @@ type MessageManager struct {
 	requester           bool
 	stopRequest         bool
 
+	readBufferSize        int
+	readBufferMaxSize     int
+	readBufferShrinkDelay time.Duration
+
 	conn   io.ReadWriteCloser
 	parser MessageParser
 }
@@ -70,6 +75,10 @@ func NewMessageManager(conn io.ReadWriteCloser, parser MessageParser) *MessageMa
 		conn:        conn,
 		requester:   parser.IsRequester(),
 		stopRequest: false,
+
+		readBufferSize:        65536,
+		readBufferMaxSize:     16777220,
+		readBufferShrinkDelay: 10 * time.Second,
 	}
 
 	mm.messageLastIdx = 0
@@ -78,14 +87,38 @@ func NewMessageManager(conn io.ReadWriteCloser, parser MessageParser) *MessageMa
 	return mm
 }
 
+// SetReadBuffer sets the size the read buffer starts from and is shrunk back to, the largest size it can grow to,
+// which is also the largest message accepted, and how long it stays grown after the last larger read.
+// It must be called before starting the data flow
+func (mm *MessageManager) SetReadBuffer(initialSize int, maxSize int, shrinkDelay time.Duration) {
+	mm.readBufferSize = initialSize
+	mm.readBufferMaxSize = max(initialSize, maxSize)
+	mm.readBufferShrinkDelay = shrinkDelay
+}
+
 func (mm *MessageManager) dataFlow() {
 	var readBuffer *bytes.Buffer
-	readBufferRaw := make([]byte, 16777220)
+	readBufferRaw := make([]byte, mm.readBufferSize)
 	readMessage := new(bytes.Buffer)
 	replyMessage := new(bytes.Buffer)
+	lastLargeRead := time.Now()
 
 	for !mm.stopRequest {
 		if mm.messageLength != 0 {
+			if mm.messageLength > mm.readBufferMaxSize {
+				log.WithFields(log.Fields{"app": "rpcmple_go", "func": "manager"}).Errorf("message of %d bytes exceeds the read buffer size", mm.messageLength)
+				break
+			}
+			// buffers grown by large messages are released once they are no longer needed
+			if readMessage.Len() == 0 && time.Since(lastLargeRead) >= mm.readBufferShrinkDelay {
+				if len(readBufferRaw) > mm.readBufferSize {
+					readBufferRaw = make([]byte, mm.readBufferSize)
+				}
+				if readMessage.Cap() > mm.readBufferSize {
+					readMessage = new(bytes.Buffer)
+				}
+			}
+
 			n, err := mm.conn.Read(readBufferRaw)
 			if err != nil {
 				if err != io.EOF {
@@ -98,6 +131,14 @@ func (mm *MessageManager) dataFlow() {
 				break
 			}
 			readBuffer = bytes.NewBuffer(readBufferRaw[:n])
+			if n > mm.readBufferSize || mm.messageLength > mm.readBufferSize {
+				lastLargeRead = time.Now()
+			}
+			// a full read buffer means more bytes are waiting, so it is doubled for the next read
+			if n == len(readBufferRaw) && n < mm.readBufferMaxSize {
+				readBufferRaw = make([]byte, min(2*n, mm.readBufferMaxSize))
+				lastLargeRead = time.Now()
+			}
 		} else {
 			readBuffer = bytes.NewBuffer(nil)
 			replyMessage.Reset()